@@ -0,0 +1,396 @@
+// overhead of condition_variable_any2:
+// - fixed cost per wait: wait(stop_token) with a satisfied predicate
+//   and wait_until() with an expired deadline (with and without stop_token)
+// - notify_one()/notify_all() on an idle condition variable (no waiters)
+// - ping-pong of two threads over one condition variable (round trips per second)
+//   also with stop-aware waits registering the stop_token per wait or once (stop_waiter)
+// - notify_all() rounds with many waiters (stop_token aware waits with predicate)
+// - stopping many waiters one by one, each using its own stop_token
+// - notify_all() under the lock to waiters doing some work under the lock:
+//   with unique_lock<mutex> waiters are woken up one after the other (wait morphing),
+//   with another lock type (here a mutex subclass) all at once
+//   (context switches per broadcast from getrusage())
+// - batches of items: notify_one() per item, notify_all(), or notify_n() per batch
+//   (time per batch and wakeups of consumers finding no item)
+// compile with -DCV_ANY2_FUTEX (make bench_cv_futex) to compare with the futex mode
+#include "condition_variable_any2.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+using namespace::std::literals;
+
+template <typename Fn>
+double nsPerOp(long numOps, Fn fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < numOps; ++i) {
+    fn();
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(numOps);
+}
+
+void benchFixedCost(long numOps)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  std::stop_source ssrc;
+  const auto past = std::chrono::steady_clock::now() - 1s;
+  std::unique_lock lock{mx};
+  int spurious = 0;
+  double satisfiedNs = nsPerOp(numOps, [&] {
+                         if (!cv.wait(lock, ssrc.get_token(), [&] { return spurious >= 0; })) {
+                           ++spurious;
+                         }
+                       });
+  double plainNs = nsPerOp(numOps, [&] {
+                     cv.wait_until(lock, past);
+                   });
+  const std::stop_token st = ssrc.get_token();
+  double stopNs = nsPerOp(numOps, [&] {
+                    if (cv.wait_until(lock, st, past, [&] { return spurious < 0; })) {
+                      ++spurious;
+                    }
+                  });
+  std::condition_variable_any2::stop_waiter waiter{cv, st};
+  double waiterNs = nsPerOp(numOps, [&] {
+                      if (waiter.wait_until(lock, past, [&] { return spurious < 0; })) {
+                        ++spurious;
+                      }
+                    });
+  std::cout << "satisfied wait(stop_token):      " << std::setw(8) << std::fixed << std::setprecision(1)
+            << satisfiedNs << " ns\n"
+            << "expired wait_until():            " << std::setw(8) << plainNs << " ns\n"
+            << "expired wait_until(stop_token):  " << std::setw(8) << stopNs << " ns\n"
+            << "expired stop_waiter.wait_until():" << std::setw(8) << waiterNs << " ns\n";
+}
+
+void benchIdleNotify(long numOps)
+{
+  std::condition_variable_any2 cv;
+  double oneNs = nsPerOp(numOps, [&] {
+                   cv.notify_one();
+                 });
+  double allNs = nsPerOp(numOps, [&] {
+                   cv.notify_all();
+                 });
+  std::cout << "idle notify_one():               " << std::setw(8) << std::setprecision(1)
+            << oneNs << " ns\n"
+            << "idle notify_all():               " << std::setw(8) << allNs << " ns\n";
+}
+
+void benchPingPong(long numRounds)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  long turn = 0;   // even: main thread, odd: partner
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread partner{[&] (std::stop_token st) {
+                           std::unique_lock lock{mx};
+                           while (cv.wait(lock, st, [&] { return turn % 2 == 1; })) {
+                             ++turn;
+                             cv.notify_one();
+                           }
+                         }};
+    std::unique_lock lock{mx};
+    for (long i = 0; i < numRounds; ++i) {
+      ++turn;
+      cv.notify_one();
+      cv.wait(lock, [&] { return turn % 2 == 0; });
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "ping-pong:                       " << std::setw(8) << std::setprecision(0)
+            << numRounds / elapsed.count() << " round trips/s\n";
+}
+
+// both threads use stop-aware waits:
+template <bool useStopWaiter>
+void benchStopPingPong(long numRounds)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  long turn = 0;   // even: main thread, odd: partner
+  auto pingPong = [&] (std::stop_token st, long parity) {
+                    std::unique_lock lock{mx};
+                    auto myTurn = [&] { return turn % 2 == parity; };
+                    if constexpr (useStopWaiter) {
+                      std::condition_variable_any2::stop_waiter waiter{cv, st};
+                      while (turn < 2 * numRounds && waiter.wait(lock, myTurn)) {
+                        ++turn;
+                        cv.notify_one();
+                      }
+                    }
+                    else {
+                      while (turn < 2 * numRounds && cv.wait(lock, st, myTurn)) {
+                        ++turn;
+                        cv.notify_one();
+                      }
+                    }
+                  };
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread partner{pingPong, 1L};
+    std::stop_source ssrc;
+    pingPong(ssrc.get_token(), 0L);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << (useStopWaiter ? "ping-pong with stop_waiter:      " : "ping-pong with wait(stop_token): ")
+            << std::setw(8) << std::setprecision(0) << numRounds / elapsed.count() << " round trips/s\n";
+}
+
+void benchNotifyAll(int numWaiters, long numRounds)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  long generation = 0;
+  int acknowledged = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> waiters;
+    for (int i = 0; i < numWaiters; ++i) {
+      waiters.emplace_back([&] (std::stop_token st) {
+                             std::unique_lock lock{mx};
+                             long seen = 0;
+                             while (cv.wait(lock, st, [&] { return generation != seen; })) {
+                               seen = generation;
+                               if (++acknowledged == numWaiters) {
+                                 cv.notify_all();
+                               }
+                             }
+                           });
+    }
+    std::unique_lock lock{mx};
+    for (long i = 0; i < numRounds; ++i) {
+      acknowledged = 0;
+      ++generation;
+      cv.notify_all();
+      cv.wait(lock, [&] { return acknowledged == numWaiters; });
+    }
+    lock.unlock();
+    for (auto& t : waiters) {
+      t.request_stop();
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(8) << numWaiters << std::setw(16) << std::setprecision(1)
+            << elapsed.count() / static_cast<double>(numRounds) << '\n';
+}
+
+void benchStopOneByOne(int numWaiters)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  long numPredCalls = 0;
+  std::vector<std::stop_source> ssources(numWaiters);
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < numWaiters; ++i) {
+    waiters.emplace_back([&, st = ssources[i].get_token()] {
+                           std::unique_lock lock{mx};
+                           cv.wait(lock, st, [&] { ++numPredCalls; return false; });
+                         });
+  }
+  for (bool allWaiting = false; !allWaiting; ) {
+    std::this_thread::sleep_for(1ms);
+    std::lock_guard lg{mx};
+    allWaiting = numPredCalls >= numWaiters;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numWaiters; ++i) {
+    ssources[i].request_stop();
+    waiters[i].join();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(8) << numWaiters << std::setw(21) << std::setprecision(1)
+            << elapsed.count() / numWaiters
+            << std::setw(21) << static_cast<double>(numPredCalls - numWaiters) / numWaiters << '\n';
+}
+
+long contextSwitches()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+// not a plain std::mutex for condition_variable_any2, so no wait morphing:
+struct OtherMutex : std::mutex {
+};
+
+template <typename Mutex>
+void benchBroadcast(const char* name, int numWaiters, long numRounds)
+{
+  Mutex mx;
+  std::condition_variable_any2 cv;
+  std::condition_variable_any2 ackCV;
+  long generation = 0;
+  int acknowledged = 0;
+  bool done = false;
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < numWaiters; ++i) {
+    waiters.emplace_back([&] {
+                           std::unique_lock<Mutex> lock{mx};
+                           for (long seen = 0; ; seen = generation) {
+                             while (generation == seen && !done) {
+                               cv.wait(lock);
+                             }
+                             if (done) {
+                               break;
+                             }
+                             // some work under the lock:
+                             auto end = std::chrono::steady_clock::now() + 1us;
+                             while (std::chrono::steady_clock::now() < end) {
+                             }
+                             if (++acknowledged == numWaiters) {
+                               ackCV.notify_one();
+                             }
+                           }
+                         });
+  }
+  {
+    std::unique_lock<Mutex> lock{mx};
+    ackCV.wait(lock, [&] { return acknowledged == 0; });
+  }
+  const long csStart = contextSwitches();
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < numRounds; ++i) {
+    std::unique_lock<Mutex> lock{mx};
+    acknowledged = 0;
+    ++generation;
+    cv.notify_all();
+    ackCV.wait(lock, [&] { return acknowledged == numWaiters; });
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  const long cs = contextSwitches() - csStart;
+  {
+    std::unique_lock<Mutex> lock{mx};
+    done = true;
+    cv.notify_all();
+  }
+  for (auto& t : waiters) {
+    t.join();
+  }
+  std::cout << std::setw(8) << numWaiters << "  " << std::setw(18) << std::left << name << std::right
+            << std::setw(14) << std::setprecision(1) << elapsed.count() / static_cast<double>(numRounds)
+            << std::setw(22) << static_cast<double>(cs) / static_cast<double>(numRounds) << '\n';
+}
+
+enum class BatchNotify { one_per_item, all, n };
+
+// a producer pushes batches of items, consumers (twice as many) take one item per wakeup:
+void benchBatch(BatchNotify how, int batchSize, long numBatches)
+{
+  const int numConsumers = 2 * batchSize;
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  std::condition_variable_any2 emptyCV;
+  int items = 0;
+  long numEmptyWakeups = 0;
+  bool done = false;
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < numConsumers; ++i) {
+    consumers.emplace_back([&] {
+                             std::unique_lock lock{mx};
+                             while (true) {
+                               while (items == 0 && !done) {
+                                 cv.wait(lock);
+                                 if (items == 0 && !done) {
+                                   ++numEmptyWakeups;
+                                 }
+                               }
+                               if (done) {
+                                 break;
+                               }
+                               if (--items == 0) {
+                                 emptyCV.notify_one();
+                               }
+                             }
+                           });
+  }
+  std::this_thread::sleep_for(10ms);
+  numEmptyWakeups = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < numBatches; ++i) {
+    {
+      std::lock_guard lg{mx};
+      items = batchSize;
+    }
+    switch (how) {
+      case BatchNotify::one_per_item:
+        for (int n = 0; n < batchSize; ++n) {
+          cv.notify_one();
+        }
+        break;
+      case BatchNotify::all:
+        cv.notify_all();
+        break;
+      case BatchNotify::n:
+        cv.notify_n(batchSize);
+        break;
+    }
+    std::unique_lock lock{mx};
+    emptyCV.wait(lock, [&] { return items == 0; });
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  long numEmpty;
+  {
+    std::lock_guard lg{mx};
+    numEmpty = numEmptyWakeups;
+    done = true;
+  }
+  cv.notify_all();
+  for (auto& t : consumers) {
+    t.join();
+  }
+  static const char* names[] = { "notify_one() each", "notify_all()", "notify_n()" };
+  std::cout << std::setw(8) << batchSize << "  " << std::setw(18) << std::left << names[static_cast<int>(how)]
+            << std::right << std::setw(14) << std::setprecision(1)
+            << elapsed.count() / static_cast<double>(numBatches)
+            << std::setw(22) << static_cast<double>(numEmpty) / static_cast<double>(numBatches) << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+  const long numOps = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+#ifdef CV_ANY2_FUTEX
+  std::cout << "condition_variable_any2 (futex mode):\n";
+#else
+  std::cout << "condition_variable_any2 (wait nodes):\n";
+#endif
+  benchFixedCost(numOps);
+  benchIdleNotify(numOps * 10);
+  benchPingPong(numOps / 10);
+  benchStopPingPong<false>(numOps / 10);
+  benchStopPingPong<true>(numOps / 10);
+  std::cout << "\nnotify_all() to many waiters (all waking up and acknowledging):\n"
+            << " waiters  us per round\n";
+  for (int n : {1, 4, 16, 64, 256}) {
+    benchNotifyAll(n, std::max(10L, numOps / 100 / n));
+  }
+  std::cout << "\nnotify_all() under the lock, waiters working 1us under the lock:\n"
+            << " waiters  user lock             us per round  context switches/round\n";
+  for (int n : {4, 16, 64}) {
+    benchBroadcast<std::mutex>("unique_lock<mutex>", n, std::max(10L, numOps / 100 / n));
+    benchBroadcast<OtherMutex>("other lock type", n, std::max(10L, numOps / 100 / n));
+  }
+  std::cout << "\nbatches of items for twice as many waiting consumers:\n"
+            << "   batch  wakeup by           us per batch  empty wakeups/batch\n";
+  for (int n : {1, 4, 16, 64, 256}) {
+    for (auto how : {BatchNotify::one_per_item, BatchNotify::all, BatchNotify::n}) {
+      benchBatch(how, n, std::max(10L, numOps / 100 / n));
+    }
+  }
+  std::cout << "\nrequest_stop() for one waiter after the other (each with its own stop_token):\n"
+            << " waiters  us per stop+join  pred calls per stop\n";
+  for (int n : {16, 64, 256}) {
+    benchStopOneByOne(n);
+  }
+}
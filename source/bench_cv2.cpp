@@ -0,0 +1,156 @@
+// condition_variable2 (only for unique_lock<mutex>) compared with
+// condition_variable_any2 and std::condition_variable:
+// - expired wait_until() (with stop_token where supported)
+// - ping-pong of two threads over one condition variable (round trips per second)
+//   also with stop-aware waits
+// - notify_all() rounds with many waiters
+#include "condition_variable2.hpp"
+#include "condition_variable_any2.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+using namespace::std::literals;
+
+template <typename CV>
+constexpr bool stopAware = !std::is_same_v<CV, std::condition_variable>;
+
+template <typename Fn>
+double nsPerOp(long numOps, Fn fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < numOps; ++i) {
+    fn();
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(numOps);
+}
+
+template <typename CV>
+void benchExpired(const char* name, long numOps)
+{
+  std::mutex mx;
+  CV cv;
+  std::stop_source ssrc;
+  const auto past = std::chrono::steady_clock::now() - 1s;
+  std::unique_lock lock{mx};
+  int spurious = 0;
+  double plainNs = nsPerOp(numOps, [&] {
+                     cv.wait_until(lock, past);
+                   });
+  std::cout << std::setw(26) << std::left << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(12) << plainNs;
+  if constexpr (stopAware<CV>) {
+    const std::stop_token st = ssrc.get_token();
+    double stopNs = nsPerOp(numOps, [&] {
+                      if (cv.wait_until(lock, st, past, [&] { return spurious < 0; })) {
+                        ++spurious;
+                      }
+                    });
+    std::cout << std::setw(22) << stopNs;
+  }
+  std::cout << '\n';
+}
+
+template <typename CV>
+void benchPingPong(const char* name, long numRounds)
+{
+  std::mutex mx;
+  CV cv;
+  long turn = 0;   // even: main thread, odd: partner
+  auto pingPong = [&] (std::stop_token st, long parity) {
+                    std::unique_lock lock{mx};
+                    auto myTurn = [&] { return turn % 2 == parity; };
+                    if constexpr (stopAware<CV>) {
+                      while (turn < 2 * numRounds && cv.wait(lock, st, myTurn)) {
+                        ++turn;
+                        cv.notify_one();
+                      }
+                    }
+                    else {
+                      while (turn < 2 * numRounds) {
+                        cv.wait(lock, myTurn);
+                        ++turn;
+                        cv.notify_one();
+                      }
+                    }
+                  };
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread partner{pingPong, 1L};
+    std::stop_source ssrc;
+    pingPong(ssrc.get_token(), 0L);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(26) << std::left << name << std::right
+            << std::setw(12) << std::setprecision(0) << numRounds / elapsed.count() << '\n';
+}
+
+template <typename CV>
+void benchNotifyAll(const char* name, int numWaiters, long numRounds)
+{
+  std::mutex mx;
+  CV cv;
+  long generation = 0;
+  int acknowledged = 0;
+  bool done = false;
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> waiters;
+    for (int i = 0; i < numWaiters; ++i) {
+      waiters.emplace_back([&] {
+                             std::unique_lock lock{mx};
+                             for (long seen = 0; ; seen = generation) {
+                               cv.wait(lock, [&] { return generation != seen || done; });
+                               if (done) {
+                                 break;
+                               }
+                               if (++acknowledged == numWaiters) {
+                                 cv.notify_all();
+                               }
+                             }
+                           });
+    }
+    std::unique_lock lock{mx};
+    for (long i = 0; i < numRounds; ++i) {
+      acknowledged = 0;
+      ++generation;
+      cv.notify_all();
+      cv.wait(lock, [&] { return acknowledged == numWaiters; });
+    }
+    done = true;
+    cv.notify_all();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(8) << numWaiters << "  " << std::setw(26) << std::left << name << std::right
+            << std::setw(14) << std::setprecision(1) << elapsed.count() / static_cast<double>(numRounds) << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+  const long numOps = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+  std::cout << "expired wait_until():           plain (ns)  with stop_token (ns)\n";
+  benchExpired<std::condition_variable2>("condition_variable2", numOps);
+  benchExpired<std::condition_variable_any2>("condition_variable_any2", numOps);
+  benchExpired<std::condition_variable>("std::condition_variable", numOps);
+
+  std::cout << "\nping-pong (stop-aware waits where supported): round trips/s\n";
+  benchPingPong<std::condition_variable2>("condition_variable2", numOps / 10);
+  benchPingPong<std::condition_variable_any2>("condition_variable_any2", numOps / 10);
+  benchPingPong<std::condition_variable>("std::condition_variable", numOps / 10);
+
+  std::cout << "\nnotify_all() to many waiters (all waking up and acknowledging):\n"
+            << " waiters  condition variable          us per round\n";
+  for (int n : {1, 4, 16, 64}) {
+    const long numRounds = std::max(10L, numOps / 100 / n);
+    benchNotifyAll<std::condition_variable2>("condition_variable2", n, numRounds);
+    benchNotifyAll<std::condition_variable_any2>("condition_variable_any2", n, numRounds);
+    benchNotifyAll<std::condition_variable>("std::condition_variable", n, numRounds);
+  }
+}
@@ -0,0 +1,100 @@
+// fairness of notify_one() of condition_variable_any2:
+// - one producer pushes items into a queue and calls notify_one() for each of them,
+//   many consumers wait for items and process them for a while without holding the lock
+// - prints how evenly the items are distributed to the consumers
+//   and percentiles of the time an item waits in the queue
+// compile with -DCV_ANY2_LIFO (make bench_cv_fairness_lifo) to wake up the newest waiter first
+#include "condition_variable_any2.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <vector>
+using namespace::std::literals;
+
+using Clock = std::chrono::steady_clock;
+
+void busyFor(std::chrono::nanoseconds dur)
+{
+  auto end = Clock::now() + dur;
+  while (Clock::now() < end) {
+  }
+}
+
+void benchFairness(int numConsumers, long numItems, std::chrono::nanoseconds work)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  std::deque<Clock::time_point> queue;
+  std::vector<long> numPerConsumer(numConsumers);
+  std::vector<std::vector<long>> delays(numConsumers);
+  {
+    std::vector<std::jthread> consumers;
+    for (int i = 0; i < numConsumers; ++i) {
+      delays[i].reserve(numItems);
+      consumers.emplace_back([&, i] (std::stop_token st) {
+                               std::unique_lock lock{mx};
+                               while (cv.wait(lock, st, [&] { return !queue.empty(); })) {
+                                 auto pushed = queue.front();
+                                 queue.pop_front();
+                                 lock.unlock();
+                                 delays[i].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                       Clock::now() - pushed).count());
+                                 ++numPerConsumer[i];
+                                 busyFor(work);
+                                 lock.lock();
+                               }
+                             });
+    }
+    std::this_thread::sleep_for(10ms);
+    for (long n = 0; n < numItems; ++n) {
+      {
+        std::lock_guard lg{mx};
+        queue.push_back(Clock::now());
+      }
+      cv.notify_one();
+      busyFor(work / numConsumers);
+    }
+    for (bool empty = false; !empty; ) {
+      std::this_thread::sleep_for(1ms);
+      std::lock_guard lg{mx};
+      empty = queue.empty();
+    }
+  }
+
+  std::vector<long> all;
+  for (const auto& d : delays) {
+    all.insert(all.end(), d.begin(), d.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto pct = [&] (double p) {
+               return all[std::min(all.size() - 1, static_cast<std::size_t>(p / 100 * all.size()))] / 1000.0;
+             };
+  auto [minIt, maxIt] = std::minmax_element(numPerConsumer.begin(), numPerConsumer.end());
+  std::cout << std::setw(10) << numConsumers
+            << std::setw(10) << *minIt << std::setw(10) << *maxIt
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << pct(50) << std::setw(10) << pct(99)
+            << std::setw(10) << pct(99.9) << std::setw(10) << all.back() / 1000.0 << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+  const long numItems = argc > 1 ? std::atol(argv[1]) : 100000;
+  const auto work = std::chrono::microseconds(argc > 2 ? std::atol(argv[2]) : 5);
+
+#ifdef CV_ANY2_LIFO
+  std::cout << "condition_variable_any2 (LIFO, newest waiter first):\n";
+#else
+  std::cout << "condition_variable_any2 (oldest waiter first):\n";
+#endif
+  std::cout << numItems << " items, " << work.count() << "us work per item\n"
+            << " consumers  min items max items   p50(us)   p99(us) p99.9(us)   max(us)\n";
+  for (int n : {2, 4, 8, 16}) {
+    benchFairness(n, numItems, work);
+  }
+}
@@ -0,0 +1,113 @@
+// wakeup latency of condition_variable_any2:
+// - a waiter waits for a flag, which another thread sets after a delay
+//   (busy for a few microseconds), followed by notify_one() or request_stop()
+// - prints histograms of the time from notifying until the waiter runs again
+// compile with -DCV_ANY2_SPIN (make bench_cv_spin_on) to spin before blocking
+#include "condition_variable_any2.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+using namespace::std::literals;
+
+using Clock = std::chrono::steady_clock;
+
+void busyFor(std::chrono::nanoseconds dur)
+{
+  auto end = Clock::now() + dur;
+  while (Clock::now() < end) {
+  }
+}
+
+// buckets: <1us, <2us, <4us, ..., <512us, more
+struct Histogram {
+  std::array<long, 11> buckets{};
+  void add(std::chrono::nanoseconds latency) {
+    std::size_t i = 0;
+    for (auto limit = 1000ns; i + 1 < buckets.size() && latency >= limit; limit *= 2) {
+      ++i;
+    }
+    ++buckets[i];
+  }
+  void print(const char* name, std::chrono::microseconds delay, long numRounds) const {
+    std::cout << std::setw(16) << std::left << name << std::right << std::setw(6) << delay.count();
+    for (long n : buckets) {
+      std::cout << std::setw(7) << std::fixed << std::setprecision(1) << 100.0 * n / numRounds;
+    }
+    std::cout << '\n';
+  }
+};
+
+// useStop: the waiter is woken up by request_stop() instead of notify_one()
+template <bool useStop>
+void benchLatency(std::chrono::microseconds delay, long numRounds)
+{
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  bool ready = false;
+  bool waiting = false;
+  std::atomic<Clock::time_point> notified{};
+  Histogram hist;
+  for (long i = 0; i < numRounds; ++i) {
+    std::stop_source ssrc;
+    std::jthread waiter{[&, st = ssrc.get_token()] {
+                          std::unique_lock lock{mx};
+                          waiting = true;
+                          if constexpr (useStop) {
+                            cv.wait(lock, st, [&] { return false; });
+                          }
+                          else {
+                            cv.wait(lock, [&] { return ready; });
+                            ready = false;
+                          }
+                          hist.add(Clock::now() - notified.load());
+                        }};
+    for (bool isWaiting = false; !isWaiting; ) {
+      std::this_thread::yield();
+      std::lock_guard lg{mx};
+      isWaiting = waiting;
+    }
+    busyFor(delay);
+    if constexpr (useStop) {
+      notified = Clock::now();
+      ssrc.request_stop();
+    }
+    else {
+      {
+        std::lock_guard lg{mx};
+        ready = true;
+        waiting = false;
+      }
+      notified = Clock::now();
+      cv.notify_one();
+    }
+    waiter.join();
+    waiting = false;
+  }
+  hist.print(useStop ? "request_stop()" : "notify_one()", delay, numRounds);
+}
+
+int main(int argc, char* argv[])
+{
+  const long numRounds = argc > 1 ? std::atol(argv[1]) : 10000;
+
+#ifdef CV_ANY2_SPIN
+  std::cout << "condition_variable_any2 (spinning up to " << CV_ANY2_SPIN_MAX << " iterations before blocking):\n";
+#else
+  std::cout << "condition_variable_any2 (blocking immediately):\n";
+#endif
+  std::cout << std::thread::hardware_concurrency() << " hardware threads, "
+            << numRounds << " wakeups per row, % of wakeups taking\n"
+            << "wakeup by     delay(us)    <1us   <2us   <4us   <8us  <16us  <32us  <64us <128us <256us <512us   more\n";
+  for (auto delay : {0us, 2us, 5us, 20us, 100us}) {
+    benchLatency<false>(delay, numRounds);
+  }
+  for (auto delay : {0us, 5us, 100us}) {
+    benchLatency<true>(delay, numRounds);
+  }
+}
@@ -0,0 +1,49 @@
+// shutdown latency of many jthreads:
+// - vector<jthread>: each ~jthread() signals stop and joins, one after the other
+// - jthread_group:   stop is signaled to all threads before the first join
+#include "jthread_group.hpp"
+#include "condition_variable_any2.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+using namespace::std::literals;
+
+// each thread blocks until it is stopped and then needs some time to clean up:
+struct Worker {
+  std::chrono::microseconds cleanup;
+  void operator() (std::stop_token st) const {
+    std::mutex mx;
+    std::condition_variable_any2 cv;
+    std::unique_lock<std::mutex> lock{mx};
+    cv.wait(lock, st, [] { return false; });
+    std::this_thread::sleep_for(cleanup);
+  }
+};
+
+template <typename Container>
+double shutdownMillis(int numThreads, std::chrono::microseconds cleanup)
+{
+  std::chrono::steady_clock::time_point start;
+  {
+    Container threads;
+    for (int i = 0; i < numThreads; ++i) {
+      threads.emplace_back(Worker{cleanup});
+    }
+    std::this_thread::sleep_for(100ms);   // let all threads block
+    start = std::chrono::steady_clock::now();
+  } // destruction stops and joins all threads
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+  const int numThreads = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const auto cleanup = std::chrono::microseconds{argc > 2 ? std::atoi(argv[2]) : 1000};
+
+  std::cout << "shutdown of " << numThreads << " threads with " << cleanup.count() << "us cleanup each:\n";
+  std::cout << "  vector<jthread>: " << shutdownMillis<std::vector<std::jthread>>(numThreads, cleanup) << "ms\n";
+  std::cout << "  jthread_group:   " << shutdownMillis<std::jthread_group>(numThreads, cleanup) << "ms\n";
+}
@@ -0,0 +1,115 @@
+// scaling of the cancellable parallel algorithms from 1 to N threads:
+// - parallel_for and parallel_transform_reduce (stop_token checked once per chunk)
+// - parallel_for with an additional stop_requested() check per element
+// and of parallel_find_if() with early exit compared to std::find_if()
+// (compile with -DWITH_STD_PAR and link the parallel backend, e.g. -ltbb,
+//  to compare with std::find_if(std::execution::par, ...))
+#include "parallel_algorithm.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#ifdef WITH_STD_PAR
+#include <execution>
+#endif
+using namespace::std::literals;
+
+template <typename Fn>
+double bestMillis(Fn fn, int runs = 5)
+{
+  double best = 1e30;
+  for (int i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+int main(int argc, char* argv[])
+{
+  const std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000000;
+  const unsigned maxThreads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+                                       : std::max(1u, std::jthread::hardware_concurrency());
+
+  std::vector<double> data(size, 2.0);
+  std::stop_source ssrc;
+  const std::stop_token st = ssrc.get_token();
+
+  std::cout << size << " elements:\n"
+            << "threads  for(ms)  speedup  for+per-elem-check(ms)  reduce(ms)  speedup\n";
+  double for1 = 0, reduce1 = 0;
+  for (unsigned n = 1; n <= maxThreads; ++n) {
+    std::thread_pool pool{n};
+    double forMs = bestMillis([&] {
+                     std::parallel_for(pool, data.begin(), data.end(),
+                                       [] (double& d) { d = std::sqrt(d * d + 1.0); }, st);
+                   });
+    double checkMs = bestMillis([&] {
+                       std::parallel_for(pool, data.begin(), data.end(),
+                                         [&st] (double& d) {
+                                           if (!st.stop_requested()) {
+                                             d = std::sqrt(d * d + 1.0);
+                                           }
+                                         }, st);
+                     });
+    double reduceMs = bestMillis([&] {
+                        volatile double sum = std::parallel_transform_reduce(pool, data.begin(), data.end(),
+                                                                             0.0, std::plus<>{},
+                                                                             [] (double d) { return std::sqrt(d); },
+                                                                             st).value;
+                        (void)sum;
+                      });
+    if (n == 1) {
+      for1 = forMs;
+      reduce1 = reduceMs;
+    }
+    std::cout << std::setw(7) << n
+              << std::setw(9) << std::fixed << std::setprecision(2) << forMs
+              << std::setw(9) << for1 / forMs
+              << std::setw(24) << checkMs
+              << std::setw(12) << reduceMs
+              << std::setw(9) << reduce1 / reduceMs << '\n';
+  }
+
+  // search for a single match at different positions:
+  std::vector<int> ints(size, 0);
+  std::thread_pool pool{maxThreads};
+  std::cout << "\nfind_if() with " << maxThreads << " threads:\n"
+            << "match at   parallel_find_if(ms)  std::find_if(ms)";
+#ifdef WITH_STD_PAR
+  std::cout << "  std::find_if(par)(ms)";
+#endif
+  std::cout << '\n';
+  for (double pos : {0.01, 0.25, 0.5, 1.0}) {
+    const std::size_t idx = std::min(size - 1, static_cast<std::size_t>(pos * static_cast<double>(size)));
+    ints[idx] = 1;
+    auto isMatch = [] (int i) { return i != 0; };
+    double parMs = bestMillis([&] {
+                     auto it = std::parallel_find_if(pool, ints.begin(), ints.end(), isMatch, st);
+                     if (it != ints.begin() + static_cast<long>(idx)) {
+                       std::cerr << "ERROR: wrong match\n";
+                     }
+                   });
+    double seqMs = bestMillis([&] {
+                     volatile bool found = std::find_if(ints.begin(), ints.end(), isMatch) != ints.end();
+                     (void)found;
+                   });
+    std::cout << std::setw(7) << std::setprecision(0) << pos * 100 << "%"
+              << std::setw(22) << std::setprecision(2) << parMs
+              << std::setw(18) << seqMs;
+#ifdef WITH_STD_PAR
+    double stdParMs = bestMillis([&] {
+                        volatile bool found = std::find_if(std::execution::par, ints.begin(), ints.end(),
+                                                           isMatch) != ints.end();
+                        (void)found;
+                      });
+    std::cout << std::setw(23) << stdParMs;
+#endif
+    std::cout << '\n';
+    ints[idx] = 0;
+  }
+}
@@ -0,0 +1,46 @@
+// throughput of a pipeline with 1 to N stages between source and sink
+// (every stage on its own jthread) for different batch sizes
+#include "pipeline.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+using namespace::std::literals;
+
+double itemsPerSec(long numItems, int numStages, std::size_t batch)
+{
+  auto start = std::chrono::steady_clock::now();
+  long sum = 0;
+  {
+    std::pipeline p{1024, batch};
+    auto out = p.add_source([i = 0L, numItems] (std::stop_token) mutable -> std::optional<long> {
+                              return i < numItems ? std::optional<long>{i++} : std::nullopt;
+                            });
+    for (int s = 0; s < numStages; ++s) {
+      out = p.add_stage(out, [] (long i) { return i + 1; });
+    }
+    p.add_sink(out, [&sum] (long i) { sum += i; });
+    p.wait();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (sum != numItems * (numItems - 1) / 2 + numItems * numStages) {
+    std::cerr << "ERROR: wrong sum " << sum << '\n';
+  }
+  return static_cast<double>(numItems) / elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+  const long numItems = argc > 1 ? std::atol(argv[1]) : 2000000;
+  const int maxStages = argc > 2 ? std::atoi(argv[2]) : 6;
+
+  std::cout << numItems << " items, Mitems/s per batch size:\n"
+            << "stages   batch=1  batch=16  batch=64  batch=256\n";
+  for (int s = 1; s <= maxStages; ++s) {
+    std::cout << std::setw(6) << s << std::fixed << std::setprecision(2);
+    for (std::size_t batch : {1u, 16u, 64u, 256u}) {
+      std::cout << std::setw(batch < 100 ? 10 : 11) << itemsPerSec(numItems, s, batch) / 1e6;
+    }
+    std::cout << std::endl;
+  }
+}
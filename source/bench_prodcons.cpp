@@ -0,0 +1,104 @@
+// producer/consumer throughput (as in test_cvprodcons.cpp) for different numbers of threads:
+// - cv_any2:    vector + mutex + condition_variable_any2 with notify_all() per item
+// - mpmc_queue: lock-free ring buffer, parking only if full/empty
+// consumers end by request_stop() once all items were consumed
+#include "condition_variable_any2.hpp"
+#include "mpmc_queue.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+using namespace::std::literals;
+
+constexpr std::size_t maxQueueSize = 100;
+
+// queue of test_cvprodcons.cpp:
+class CVQueue {
+  public:
+    bool push(int item, std::stop_token st) {
+      std::unique_lock lock{itemsMx};
+      if (!itemsCV.wait(lock, st, [&] { return items.size() < maxQueueSize; })) {
+        return false;
+      }
+      items.push_back(item);
+      itemsCV.notify_all();
+      return true;
+    }
+    std::optional<int> pop(std::stop_token st) {
+      std::unique_lock lock{itemsMx};
+      if (!itemsCV.wait(lock, st, [&] { return !items.empty(); })) {
+        return std::nullopt;
+      }
+      int item = items.back();
+      items.pop_back();
+      itemsCV.notify_all();
+      return item;
+    }
+  private:
+    std::vector<int> items;
+    std::mutex itemsMx;
+    std::condition_variable_any2 itemsCV;
+};
+
+class MPMCQueue {
+  public:
+    bool push(int item, std::stop_token st) {
+      return q.push(item, st);
+    }
+    std::optional<int> pop(std::stop_token st) {
+      return q.pop(st);
+    }
+  private:
+    std::mpmc_queue<int> q{maxQueueSize};
+};
+
+template <typename Queue>
+double itemsPerSec(long numItems, int numProducers, int numConsumers)
+{
+  Queue q;
+  std::stop_source done;
+  std::atomic<long> consumed{0};
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (int c = 0; c < numConsumers; ++c) {
+      threads.emplace_back([&] {
+                             while (q.pop(done.get_token())) {
+                               if (consumed.fetch_add(1, std::memory_order_relaxed) + 1 == numItems) {
+                                 done.request_stop();
+                               }
+                             }
+                           });
+    }
+    for (int p = 0; p < numProducers; ++p) {
+      threads.emplace_back([&, p] {
+                             for (long i = p; i < numItems; i += numProducers) {
+                               q.push(static_cast<int>(i), done.get_token());
+                             }
+                           });
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (consumed.load() != numItems) {
+    std::cerr << "ERROR: consumed " << consumed.load() << " of " << numItems << '\n';
+  }
+  return static_cast<double>(numItems) / elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+  const long numItems = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+  std::cout << numItems << " items, Mitems/s:\n"
+            << "producers:consumers  cv_any2  mpmc_queue\n";
+  for (auto [p, c] : {std::pair{1, 1}, {1, 4}, {4, 1}, {2, 2}, {4, 4}}) {
+    std::cout << std::setw(10) << p << ":" << std::left << std::setw(9) << c << std::right
+              << std::fixed << std::setprecision(2)
+              << std::setw(8) << itemsPerSec<CVQueue>(numItems, p, c) / 1e6
+              << std::setw(12) << itemsPerSec<MPMCQueue>(numItems, p, c) / 1e6 << std::endl;
+  }
+}
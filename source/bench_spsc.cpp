@@ -0,0 +1,104 @@
+// latency of a 1:1 handoff as round trip time (ping-pong over two queues) with percentiles:
+// - spsc_queue, mpmc_queue, and bounded_queue (mutex + condition_variable_any2)
+// and throughput of spsc_queue with single and batch operations
+#include "spsc_queue.hpp"
+#include "mpmc_queue.hpp"
+#include "bounded_queue.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+using namespace::std::literals;
+
+template <typename Queue>
+void printRoundTrip(const char* name, int numRounds)
+{
+  Queue ping{64};
+  Queue pong{64};
+  std::vector<long> rtt;
+  rtt.reserve(numRounds);
+  {
+    std::jthread echo{[&] (std::stop_token st) {
+                        while (auto v = ping.pop(st)) {
+                          pong.push(*v, st);
+                        }
+                      }};
+    for (int i = 0; i < numRounds; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      ping.push(i);
+      pong.pop();
+      rtt.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start).count());
+    }
+  }
+  std::sort(rtt.begin(), rtt.end());
+  auto pct = [&] (double p) {
+               return rtt[std::min(rtt.size() - 1, static_cast<std::size_t>(p / 100 * rtt.size()))];
+             };
+  std::cout << std::left << std::setw(15) << name << std::right
+            << std::setw(9) << pct(50) << std::setw(9) << pct(90) << std::setw(9) << pct(99)
+            << std::setw(10) << pct(99.9) << std::setw(11) << rtt.back() << '\n';
+}
+
+double spscItemsPerSec(long numItems, std::size_t batch)
+{
+  std::spsc_queue<long> q{1024};
+  auto start = std::chrono::steady_clock::now();
+  long sum = 0;
+  {
+    std::jthread producer{[&] {
+                            std::vector<long> buf;
+                            for (long i = 0; i < numItems; ) {
+                              buf.clear();
+                              for (std::size_t j = 0; j < batch && i < numItems; ++j) {
+                                buf.push_back(i++);
+                              }
+                              auto it = q.try_push_batch(buf.begin(), buf.end());
+                              for (; it != buf.end(); ++it) {
+                                q.push(*it);
+                              }
+                            }
+                          }};
+    std::vector<long> buf;
+    for (long n = 0; n < numItems; ) {
+      buf.clear();
+      std::size_t got = q.try_pop_batch(std::back_inserter(buf), batch);
+      if (got == 0) {
+        buf.push_back(*q.pop());
+        got = 1;
+      }
+      for (long v : buf) {
+        sum += v;
+      }
+      n += static_cast<long>(got);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (sum != numItems * (numItems - 1) / 2) {
+    std::cerr << "ERROR: wrong sum\n";
+  }
+  return static_cast<double>(numItems) / elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+  const int numRounds = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const long numItems = argc > 2 ? std::atol(argv[2]) : 10000000;
+
+  std::cout << "round trip time of " << numRounds << " ping-pongs (ns):\n"
+            << "queue               p50      p90      p99    p99.9        max\n";
+  printRoundTrip<std::spsc_queue<int>>("spsc_queue", numRounds);
+  printRoundTrip<std::mpmc_queue<int>>("mpmc_queue", numRounds);
+  printRoundTrip<std::bounded_queue<int>>("bounded_queue", numRounds);
+
+  std::cout << "\nspsc_queue throughput of " << numItems << " items:\n"
+            << "batch  Mitems/s\n";
+  for (std::size_t batch : {1u, 16u, 256u}) {
+    std::cout << std::setw(5) << batch << std::fixed << std::setprecision(2)
+              << std::setw(10) << spscItemsPerSec(numItems, batch) / 1e6 << '\n';
+  }
+}
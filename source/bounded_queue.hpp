@@ -0,0 +1,180 @@
+// -----------------------------------------------------
+// bounded blocking queue with stop_token support:
+// -----------------------------------------------------
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include "condition_variable_any2.hpp"
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace std {
+
+//*****************************************
+//* class bounded_queue<T>
+//* - FIFO queue with a fixed capacity for multiple producers and consumers
+//* - push() blocks while the queue is full (back-pressure),
+//*   pop() blocks while the queue is empty
+//* - all blocking operations return early if stop is requested for the passed stop_token
+//*   (without blocking they succeed even if stop was requested)
+//* - batch operations move multiple elements with one lock and one notification
+//* - close() signals that no more elements are pushed:
+//*   - further pushes fail
+//*   - the remaining elements can still be popped (drain),
+//*     after that pops return without an element
+//*****************************************
+template <typename T>
+class bounded_queue
+{
+  public:
+    explicit bounded_queue(std::size_t capacity)
+     : _capacity{capacity > 0 ? capacity : 1} {
+    }
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    // push value:
+    // - returns false if closed or stopped before there was space
+    bool push(T value, stop_token stoken = {});
+
+    // push the elements of [first, last), as many at once as there is space for:
+    // - returns the position after the last element pushed
+    //   (last unless closed or stopped before)
+    template <typename InputIt>
+    InputIt push_batch(InputIt first, InputIt last, stop_token stoken = {});
+
+    // pop the next element:
+    // - returns no value if closed and empty or stopped before an element was available
+    std::optional<T> pop(stop_token stoken = {});
+
+    // append up to max available elements (at least one) to out:
+    // - returns the number of elements popped
+    //   (0 only if closed and empty or stopped before an element was available)
+    std::size_t pop_batch(std::vector<T>& out, std::size_t max, stop_token stoken = {});
+
+    // no more pushes, wakes up all blocked threads:
+    void close() noexcept;
+
+    [[nodiscard]] bool is_closed() const {
+      std::scoped_lock lg{_mx};
+      return _closed;
+    }
+    [[nodiscard]] std::size_t size() const {
+      std::scoped_lock lg{_mx};
+      return _items.size();
+    }
+    [[nodiscard]] std::size_t capacity() const noexcept {
+      return _capacity;
+    }
+
+  private:
+    const std::size_t _capacity;
+    mutable std::mutex _mx;
+    condition_variable_any2 _notFull;
+    condition_variable_any2 _notEmpty;
+    std::deque<T> _items;
+    bool _closed = false;
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class bounded_queue<T>
+//*****************************************
+
+// NOTE: notifications are done after releasing the lock, so that the woken
+//       threads don't block on the mutex immediately again
+
+template <typename T>
+inline bool bounded_queue<T>::push(T value, stop_token stoken)
+{
+  {
+    std::unique_lock lock{_mx};
+    if (!_notFull.wait(lock, stoken, [this] { return _closed || _items.size() < _capacity; })
+        || _closed) {
+      return false;
+    }
+    _items.push_back(std::move(value));
+  }
+  _notEmpty.notify_one();
+  return true;
+}
+
+template <typename T>
+template <typename InputIt>
+inline InputIt bounded_queue<T>::push_batch(InputIt first, InputIt last, stop_token stoken)
+{
+  while (first != last) {
+    {
+      std::unique_lock lock{_mx};
+      if (!_notFull.wait(lock, stoken, [this] { return _closed || _items.size() < _capacity; })
+          || _closed) {
+        return first;
+      }
+      for (std::size_t n = _capacity - _items.size(); n > 0 && first != last; --n, ++first) {
+        _items.push_back(std::move(*first));
+      }
+    }
+    _notEmpty.notify_all();
+  }
+  return first;
+}
+
+template <typename T>
+inline std::optional<T> bounded_queue<T>::pop(stop_token stoken)
+{
+  std::optional<T> value;
+  {
+    std::unique_lock lock{_mx};
+    if (!_notEmpty.wait(lock, stoken, [this] { return _closed || !_items.empty(); })
+        || _items.empty()) {
+      return value;
+    }
+    value.emplace(std::move(_items.front()));
+    _items.pop_front();
+  }
+  _notFull.notify_one();
+  return value;
+}
+
+template <typename T>
+inline std::size_t bounded_queue<T>::pop_batch(std::vector<T>& out, std::size_t max, stop_token stoken)
+{
+  std::size_t n = 0;
+  {
+    std::unique_lock lock{_mx};
+    if (!_notEmpty.wait(lock, stoken, [this] { return _closed || !_items.empty(); })) {
+      return 0;
+    }
+    for (; n < max && !_items.empty(); ++n) {
+      out.push_back(std::move(_items.front()));
+      _items.pop_front();
+    }
+  }
+  if (n > 0) {
+    _notFull.notify_all();
+  }
+  return n;
+}
+
+template <typename T>
+inline void bounded_queue<T>::close() noexcept
+{
+  {
+    std::scoped_lock lg{_mx};
+    _closed = true;
+  }
+  _notFull.notify_all();
+  _notEmpty.notify_all();
+}
+
+
+} // std
+
+#endif // BOUNDED_QUEUE_HPP
@@ -0,0 +1,304 @@
+// -----------------------------------------------------
+// coroutine support for stop_token
+// (requires compiler support for coroutines; as long as the standard
+//  library provides no <stop_token> itself, e.g. -std=c++17 -fcoroutines):
+// - co_await until_stopped(stoken) suspends until stop is requested
+// - task<T> is a lazy coroutine task whose stop_token
+//   is propagated to all child tasks it awaits
+// -----------------------------------------------------
+#ifndef CANCELLABLE_TASK_HPP
+#define CANCELLABLE_TASK_HPP
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "cancellable_task.hpp requires coroutine support"
+#endif
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace std {
+
+//*****************************************
+//* class stop_awaitable
+//* - awaitable that resumes the awaiting coroutine when stop is requested
+//*   (on the thread calling request_stop())
+//* - the stop_callback is part of the awaitable, so it lives in the
+//*   coroutine frame and registering it doesn't allocate
+//* - NOTE: if stop is never possible for the stop_token, the coroutine
+//*   is not resumed before it gets destroyed
+//*****************************************
+class stop_awaitable
+{
+    struct resumer {
+      stop_awaitable* awaitable;
+      void operator()() const noexcept {
+        // resume only if await_suspend() has completed:
+        if (awaitable->_suspended.exchange(true, std::memory_order_acq_rel)) {
+          awaitable->_handle.resume();
+        }
+      }
+    };
+
+  public:
+    explicit stop_awaitable(stop_token stoken) noexcept
+     : _stoken{std::move(stoken)} {
+    }
+    // only movable before it is awaited (compilers might move it into the frame):
+    stop_awaitable(stop_awaitable&& a) noexcept
+     : _stoken{std::move(a._stoken)} {
+    }
+    stop_awaitable& operator=(stop_awaitable&&) = delete;
+
+    bool await_ready() const noexcept {
+      return _stoken.stop_requested();
+    }
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+      _handle = h;
+      _callback.emplace(_stoken, resumer{this});
+      // if the callback was already called (inline or concurrently), don't suspend:
+      return !_suspended.exchange(true, std::memory_order_acq_rel);
+    }
+    void await_resume() const noexcept {
+    }
+
+  private:
+    stop_token _stoken;
+    std::coroutine_handle<> _handle;
+    std::atomic<bool> _suspended{false};
+    std::optional<stop_callback<resumer>> _callback;
+};
+
+[[nodiscard]] inline stop_awaitable until_stopped(stop_token stoken) noexcept {
+  return stop_awaitable{std::move(stoken)};
+}
+
+
+//*****************************************
+//* get_current_stop_token
+//* - co_await get_current_stop_token inside a task yields its stop_token
+//*****************************************
+struct get_current_stop_token_t { explicit get_current_stop_token_t() = default; };
+inline constexpr get_current_stop_token_t get_current_stop_token{};
+
+
+template <typename T = void>
+class task;
+
+template <typename T>
+T sync_wait(task<T>&& t, stop_token stoken = {});
+
+//*****************************************
+//* class __task_promise_base
+//* - everything of the promise type of task<> but the result
+//*****************************************
+class __task_promise_base
+{
+    struct __final_awaiter {
+      bool await_ready() const noexcept {
+        return false;
+      }
+      template <typename _Promise>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<_Promise> __h) noexcept {
+        __task_promise_base& __p = __h.promise();
+        if (__p.__continuation_) {
+          return __p.__continuation_;   // symmetric transfer to the awaiting task
+        }
+        // started by sync_wait():
+        // - after the store the frame and the flag might be gone immediately
+        std::atomic<std::uint32_t>* __done = __p.__done_;
+        __done->store(1, std::memory_order_release);
+        __futex_wake_all(__done);
+        return std::noop_coroutine();
+      }
+      void await_resume() const noexcept {
+      }
+    };
+
+    struct __stop_token_awaiter {
+      stop_token __stoken_;
+      bool await_ready() const noexcept {
+        return true;
+      }
+      void await_suspend(std::coroutine_handle<>) const noexcept {
+      }
+      stop_token await_resume() noexcept {
+        return std::move(__stoken_);
+      }
+    };
+
+  public:
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+    __final_awaiter final_suspend() const noexcept {
+      return {};
+    }
+    void unhandled_exception() noexcept {
+      __exception_ = std::current_exception();
+    }
+
+    // awaiting a child task passes our stop_token to it:
+    template <typename _U>
+    auto await_transform(task<_U>&& __child) noexcept {
+      __child.__handle_.promise().__stoken_ = __stoken_;
+      return typename task<_U>::__awaiter{__child.__handle_};
+    }
+    __stop_token_awaiter await_transform(get_current_stop_token_t) const noexcept {
+      return __stop_token_awaiter{__stoken_};
+    }
+    // all other awaitables are used as they are:
+    template <typename _Awaitable>
+    _Awaitable&& await_transform(_Awaitable&& __a) const noexcept {
+      return std::forward<_Awaitable>(__a);
+    }
+
+  protected:
+    void __rethrow_if_failed() {
+      if (__exception_) {
+        std::rethrow_exception(__exception_);
+      }
+    }
+
+  private:
+    template <typename _U>
+    friend class task;
+    template <typename _U>
+    friend _U sync_wait(task<_U>&&, stop_token);
+
+    stop_token __stoken_;
+    std::coroutine_handle<> __continuation_;
+    std::atomic<std::uint32_t>* __done_ = nullptr;
+    std::exception_ptr __exception_;
+};
+
+template <typename _T>
+class __task_promise : public __task_promise_base
+{
+  public:
+    task<_T> get_return_object() noexcept;
+
+    template <typename _V, typename = std::enable_if_t<std::is_convertible_v<_V&&, _T>>>
+    void return_value(_V&& __v) {
+      __value_.emplace(std::forward<_V>(__v));
+    }
+
+    _T __result() {
+      __rethrow_if_failed();
+      return std::move(*__value_);
+    }
+
+  private:
+    std::optional<_T> __value_;
+};
+
+template <>
+class __task_promise<void> : public __task_promise_base
+{
+  public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {
+    }
+
+    void __result() {
+      __rethrow_if_failed();
+    }
+};
+
+
+//*****************************************
+//* class task<T>
+//* - lazily started coroutine task yielding a T
+//* - move-only, co_await it as rvalue
+//* - started either by co_await in another task (then it gets the
+//*   stop_token of the awaiting task) or by sync_wait()
+//*****************************************
+template <typename T>
+class [[nodiscard]] task
+{
+  public:
+    using promise_type = __task_promise<T>;
+    using value_type = T;
+
+    task() noexcept = default;
+    task(task&& t) noexcept
+     : __handle_{std::exchange(t.__handle_, nullptr)} {
+    }
+    task& operator=(task&& t) noexcept {
+      task tmp{std::move(t)};
+      std::swap(__handle_, tmp.__handle_);
+      return *this;
+    }
+    ~task() {
+      if (__handle_) {
+        __handle_.destroy();
+      }
+    }
+
+  private:
+    friend class __task_promise_base;
+    friend class __task_promise<T>;
+    template <typename _U>
+    friend _U sync_wait(task<_U>&&, stop_token);
+
+    explicit task(std::coroutine_handle<promise_type> h) noexcept
+     : __handle_{h} {
+    }
+
+    struct __awaiter {
+      std::coroutine_handle<promise_type> __child_;
+      bool await_ready() const noexcept {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> __parent) noexcept {
+        __child_.promise().__continuation_ = __parent;
+        return __child_;   // start the child
+      }
+      T await_resume() {
+        return __child_.promise().__result();
+      }
+    };
+
+    std::coroutine_handle<promise_type> __handle_;
+};
+
+template <typename _T>
+inline task<_T> __task_promise<_T>::get_return_object() noexcept {
+  return task<_T>{std::coroutine_handle<__task_promise<_T>>::from_promise(*this)};
+}
+
+inline task<void> __task_promise<void>::get_return_object() noexcept {
+  return task<void>{std::coroutine_handle<__task_promise<void>>::from_promise(*this)};
+}
+
+
+//*****************************************
+//* sync_wait()
+//* - runs a task with the passed stop_token and blocks until it is done
+//* - returns its result or rethrows its exception
+//*****************************************
+template <typename T>
+T sync_wait(task<T>&& t, stop_token stoken)
+{
+  auto& p = t.__handle_.promise();
+  p.__stoken_ = std::move(stoken);
+  std::atomic<std::uint32_t> done{0};
+  p.__done_ = &done;
+  t.__handle_.resume();
+  // the task might be resumed and finished by other threads:
+  while (done.load(std::memory_order_acquire) == 0) {
+    __futex_wait(&done, 0);
+  }
+  return p.__result();
+}
+
+
+} // std
+
+#endif // CANCELLABLE_TASK_HPP
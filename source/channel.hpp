@@ -0,0 +1,453 @@
+// -----------------------------------------------------
+// Go-style channels with select() over multiple channels and a stop_token:
+// -----------------------------------------------------
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace std {
+
+template <typename T> class channel;
+
+//*****************************************
+//* internal state of one blocked select() (or blocking send()/recv()):
+//* - the select enqueues one waiter node per case into the wait queues of the channels
+//* - a thread completing one of these cases first claims the state,
+//*   so that exactly one case fires, then transfers the value and wakes
+//*   only this thread (no notify_all() to all threads waiting on a channel)
+//* - a stop request claims the state as well
+//*****************************************
+struct __select_state {
+  static constexpr std::uint32_t __waiting = 0;
+  static constexpr std::uint32_t __claimed = 1;   // a case is being completed
+  static constexpr std::uint32_t __done = 2;      // __fired_ is the case that completed
+  static constexpr std::uint32_t __stopped = 3;
+
+  std::atomic<std::uint32_t> __state_{__waiting};
+  std::size_t __fired_ = 0;
+
+  bool __try_claim() noexcept {
+    std::uint32_t __exp = __waiting;
+    return __state_.compare_exchange_strong(__exp, __claimed, std::memory_order_acquire,
+                                            std::memory_order_relaxed);
+  }
+  void __finish(std::size_t __idx) noexcept {
+    __fired_ = __idx;
+    // after the store the waiting thread might return and destroy *this:
+    std::atomic<std::uint32_t>* __st = &__state_;
+    __st->store(__done, std::memory_order_release);
+    __futex_wake_all(__st);
+  }
+  void __stop() noexcept {
+    std::uint32_t __exp = __waiting;
+    if (__state_.compare_exchange_strong(__exp, __stopped, std::memory_order_relaxed)) {
+      __futex_wake_all(&__state_);
+    }
+  }
+  // returns true if a case fired, false if stopped:
+  bool __wait() noexcept {
+    std::uint32_t __s;
+    while ((__s = __state_.load(std::memory_order_acquire)) < __done) {
+      __futex_wait(&__state_, __s);
+    }
+    return __s == __done;
+  }
+};
+
+// waiter node of one select case in the wait queue of a channel:
+template <typename T>
+struct __chan_waiter {
+  __select_state* __sel_ = nullptr;
+  std::size_t __index_ = 0;
+  T* __src_ = nullptr;                   // value to send
+  std::optional<T>* __dst_ = nullptr;    // where to receive into
+  bool __ok_ = false;                    // send: value was taken (not closed)
+  __chan_waiter* __next_ = nullptr;
+  __chan_waiter* __prev_ = nullptr;
+  bool __linked_ = false;
+};
+
+// intrusive FIFO of waiter nodes (guarded by the mutex of the channel):
+template <typename T>
+class __chan_waitq {
+  public:
+    void __push_back(__chan_waiter<T>* __w) noexcept {
+      __w->__next_ = nullptr;
+      __w->__prev_ = __tail_;
+      (__tail_ ? __tail_->__next_ : __head_) = __w;
+      __tail_ = __w;
+      __w->__linked_ = true;
+    }
+    void __erase(__chan_waiter<T>* __w) noexcept {
+      (__w->__prev_ ? __w->__prev_->__next_ : __head_) = __w->__next_;
+      (__w->__next_ ? __w->__next_->__prev_ : __tail_) = __w->__prev_;
+      __w->__linked_ = false;
+    }
+    // remove waiters until one can be claimed (the others are claimed by other cases or stopped):
+    __chan_waiter<T>* __pop_claimed() noexcept {
+      while (__chan_waiter<T>* __w = __head_) {
+        __erase(__w);
+        if (__w->__sel_->__try_claim()) {
+          return __w;
+        }
+      }
+      return nullptr;
+    }
+  private:
+    __chan_waiter<T>* __head_ = nullptr;
+    __chan_waiter<T>* __tail_ = nullptr;
+};
+
+
+//*****************************************
+//* class channel<T>
+//* - capacity 0: unbuffered, each send waits for a receiver (rendezvous)
+//* - capacity > 0: buffered, send only blocks if the buffer is full
+//* - close(): all pending and future sends fail,
+//*   receives still get the buffered values, then no value
+//* - blocking operations return early if stop is requested for the passed stop_token
+//* - for waiting on multiple channels see select()
+//*****************************************
+template <typename T>
+class channel
+{
+  public:
+    explicit channel(std::size_t capacity = 0)
+     : _capacity{capacity} {
+    }
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    // returns false if closed (or stopped before the value was taken):
+    bool send(T value, stop_token stoken = {});
+    // returns no value if closed and empty (or stopped before a value was available):
+    std::optional<T> recv(stop_token stoken = {});
+
+    // non-blocking versions:
+    // - try_send() returns false if it would block or if closed (value is not moved then)
+    // - try_recv() returns no value if it would block or if closed and empty
+    bool try_send(T&& value);
+    std::optional<T> try_recv();
+
+    void close();
+
+    [[nodiscard]] bool is_closed() const {
+      std::scoped_lock lg{_mx};
+      return _closed;
+    }
+    [[nodiscard]] std::size_t size() const {
+      std::scoped_lock lg{_mx};
+      return _buffer.size();
+    }
+    [[nodiscard]] std::size_t capacity() const noexcept {
+      return _capacity;
+    }
+
+  private:
+    template <typename U, typename Fn> friend class __recv_case;
+    template <typename U, typename Fn> friend class __send_case;
+
+    // operations with _mx locked:
+    // - return false if they would block
+    bool __try_recv_locked(std::optional<T>& __dst);
+    bool __try_send_locked(T& __value, bool& __ok);
+
+    const std::size_t _capacity;
+    mutable std::mutex _mx;
+    std::deque<T> _buffer;
+    __chan_waitq<T> _recvq;     // blocked receivers (only if the buffer is empty)
+    __chan_waitq<T> _sendq;     // blocked senders (only if the buffer is full)
+    bool _closed = false;
+};
+
+
+//*****************************************
+//* select cases:
+//* - on_recv(ch, fn): fn(std::optional<T>) is called with the received value
+//*   (no value if the channel is closed)
+//* - on_send(ch, value, fn): fn(bool) is called after sending
+//*   (false if the channel is closed)
+//*****************************************
+template <typename T, typename Fn>
+class __recv_case {
+  public:
+    __recv_case(channel<T>& __ch, Fn __fn) : __ch_{__ch}, __fn_{std::move(__fn)} {
+    }
+    std::mutex* __mutex() const noexcept {
+      return &__ch_._mx;
+    }
+    bool __try_now() {
+      return __ch_.__try_recv_locked(__value_);
+    }
+    void __enqueue(__select_state& __sel, std::size_t __idx) {
+      __node_.__sel_ = &__sel;
+      __node_.__index_ = __idx;
+      __node_.__dst_ = &__value_;
+      __ch_._recvq.__push_back(&__node_);
+    }
+    void __dequeue() noexcept {
+      if (__node_.__linked_) {
+        __ch_._recvq.__erase(&__node_);
+      }
+    }
+    void __complete() {
+      __fn_(std::move(__value_));
+    }
+  private:
+    channel<T>& __ch_;
+    Fn __fn_;
+    std::optional<T> __value_;
+    __chan_waiter<T> __node_;
+};
+
+template <typename T, typename Fn>
+class __send_case {
+  public:
+    __send_case(channel<T>& __ch, T __value, Fn __fn)
+     : __ch_{__ch}, __value_{std::move(__value)}, __fn_{std::move(__fn)} {
+    }
+    std::mutex* __mutex() const noexcept {
+      return &__ch_._mx;
+    }
+    bool __try_now() {
+      return __ch_.__try_send_locked(__value_, __node_.__ok_);
+    }
+    void __enqueue(__select_state& __sel, std::size_t __idx) {
+      __node_.__sel_ = &__sel;
+      __node_.__index_ = __idx;
+      __node_.__src_ = &__value_;
+      __ch_._sendq.__push_back(&__node_);
+    }
+    void __dequeue() noexcept {
+      if (__node_.__linked_) {
+        __ch_._sendq.__erase(&__node_);
+      }
+    }
+    void __complete() {
+      __fn_(__node_.__ok_);
+    }
+  private:
+    channel<T>& __ch_;
+    T __value_;
+    Fn __fn_;
+    __chan_waiter<T> __node_;
+};
+
+template <typename T, typename Fn>
+__recv_case<T, Fn> on_recv(channel<T>& ch, Fn fn)
+{
+  return __recv_case<T, Fn>{ch, std::move(fn)};
+}
+
+template <typename T, typename U, typename Fn>
+__send_case<T, Fn> on_send(channel<T>& ch, U&& value, Fn fn)
+{
+  return __send_case<T, Fn>{ch, T(std::forward<U>(value)), std::move(fn)};
+}
+
+
+//*****************************************
+//* select()
+//* - waits until one of the cases can complete or stop is requested for stoken
+//* - completes exactly one case and calls its function
+//*   (if multiple cases are ready, the first one in the argument list)
+//* - returns the index of the completed case or select_stopped
+//*****************************************
+inline constexpr std::size_t select_stopped = static_cast<std::size_t>(-1);
+
+// lock the mutexes of all channels (each once, ordered by address to avoid deadlocks):
+template <std::size_t _Num>
+class __select_lock {
+  public:
+    explicit __select_lock(std::array<std::mutex*, _Num> __mxs) noexcept
+     : __mxs_{__mxs} {
+      std::sort(__mxs_.begin(), __mxs_.end());
+      __end_ = std::unique(__mxs_.begin(), __mxs_.end());
+      lock();
+    }
+    __select_lock(const __select_lock&) = delete;
+    __select_lock& operator=(const __select_lock&) = delete;
+    ~__select_lock() {
+      if (__locked_) {
+        unlock();
+      }
+    }
+    void lock() {
+      std::for_each(__mxs_.begin(), __end_, [] (std::mutex* __m) { __m->lock(); });
+      __locked_ = true;
+    }
+    void unlock() noexcept {
+      std::for_each(__mxs_.begin(), __end_, [] (std::mutex* __m) { __m->unlock(); });
+      __locked_ = false;
+    }
+  private:
+    std::array<std::mutex*, _Num> __mxs_;
+    typename std::array<std::mutex*, _Num>::iterator __end_;
+    bool __locked_ = false;
+};
+
+template <typename... Cases>
+std::size_t select(stop_token stoken, Cases&&... cases)
+{
+  static_assert(sizeof...(Cases) > 0, "select() requires at least one case");
+  auto cs = std::forward_as_tuple(cases...);
+  constexpr std::size_t num = sizeof...(Cases);
+  __select_lock<num> lock{{cases.__mutex()...}};
+
+  // if a case can complete immediately, complete the first one:
+  std::size_t fired = select_stopped;
+  std::apply([&fired] (auto&... c) {
+               std::size_t idx = 0;
+               ((fired == select_stopped && c.__try_now() ? (fired = idx, ++idx) : ++idx), ...);
+             }, cs);
+  if (fired == select_stopped) {
+    if (stoken.stop_requested()) {
+      return select_stopped;
+    }
+    // enqueue all cases and block until one is completed by another thread or stop is requested:
+    __select_state sel;
+    std::apply([&sel] (auto&... c) {
+                 std::size_t idx = 0;
+                 (c.__enqueue(sel, idx++), ...);
+               }, cs);
+    lock.unlock();
+    bool done;
+    {
+      stop_callback cb{stoken, [&sel] { sel.__stop(); }};
+      done = sel.__wait();
+    }
+    lock.lock();
+    std::apply([] (auto&... c) { (c.__dequeue(), ...); }, cs);
+    lock.unlock();
+    if (!done) {
+      return select_stopped;
+    }
+    fired = sel.__fired_;
+  }
+  else {
+    lock.unlock();
+  }
+  std::apply([fired] (auto&... c) {
+               std::size_t idx = 0;
+               ((idx++ == fired ? c.__complete() : void()), ...);
+             }, cs);
+  return fired;
+}
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class channel<T>
+//*****************************************
+
+template <typename T>
+inline bool channel<T>::__try_recv_locked(std::optional<T>& __dst)
+{
+  if (!_buffer.empty()) {
+    __dst.emplace(std::move(_buffer.front()));
+    _buffer.pop_front();
+    // the space becoming free is taken by a blocked sender:
+    if (__chan_waiter<T>* w = _sendq.__pop_claimed()) {
+      _buffer.push_back(std::move(*w->__src_));
+      w->__ok_ = true;
+      w->__sel_->__finish(w->__index_);
+    }
+    return true;
+  }
+  // unbuffered: take the value of a blocked sender directly:
+  if (__chan_waiter<T>* w = _sendq.__pop_claimed()) {
+    __dst.emplace(std::move(*w->__src_));
+    w->__ok_ = true;
+    w->__sel_->__finish(w->__index_);
+    return true;
+  }
+  return _closed;
+}
+
+template <typename T>
+inline bool channel<T>::__try_send_locked(T& __value, bool& __ok)
+{
+  if (_closed) {
+    __ok = false;
+    return true;
+  }
+  // pass the value to a blocked receiver directly:
+  if (__chan_waiter<T>* w = _recvq.__pop_claimed()) {
+    w->__dst_->emplace(std::move(__value));
+    w->__sel_->__finish(w->__index_);
+    __ok = true;
+    return true;
+  }
+  if (_buffer.size() < _capacity) {
+    _buffer.push_back(std::move(__value));
+    __ok = true;
+    return true;
+  }
+  return false;
+}
+
+template <typename T>
+inline bool channel<T>::send(T value, stop_token stoken)
+{
+  bool ok = false;
+  select(std::move(stoken), on_send(*this, std::move(value), [&ok] (bool sent) { ok = sent; }));
+  return ok;
+}
+
+template <typename T>
+inline std::optional<T> channel<T>::recv(stop_token stoken)
+{
+  std::optional<T> value;
+  select(std::move(stoken), on_recv(*this, [&value] (std::optional<T> v) { value = std::move(v); }));
+  return value;
+}
+
+template <typename T>
+inline bool channel<T>::try_send(T&& value)
+{
+  std::scoped_lock lg{_mx};
+  bool ok = false;
+  return __try_send_locked(value, ok) && ok;
+}
+
+template <typename T>
+inline std::optional<T> channel<T>::try_recv()
+{
+  std::optional<T> value;
+  std::scoped_lock lg{_mx};
+  __try_recv_locked(value);
+  return value;
+}
+
+template <typename T>
+inline void channel<T>::close()
+{
+  std::scoped_lock lg{_mx};
+  _closed = true;
+  // blocked receivers get no value, blocked senders fail:
+  while (__chan_waiter<T>* w = _recvq.__pop_claimed()) {
+    w->__sel_->__finish(w->__index_);
+  }
+  while (__chan_waiter<T>* w = _sendq.__pop_claimed()) {
+    w->__ok_ = false;
+    w->__sel_->__finish(w->__index_);
+  }
+}
+
+
+} // std
+
+#endif // CHANNEL_HPP
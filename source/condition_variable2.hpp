@@ -0,0 +1,251 @@
+// -----------------------------------------------------
+// condition variable for unique_lock<mutex>
+// with stop_token support:
+// -----------------------------------------------------
+#ifndef CONDITION_VARIABLE2_MUTEX_HPP
+#define CONDITION_VARIABLE2_MUTEX_HPP
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace std {
+
+//*****************************************
+//* class condition_variable2
+//* - like condition_variable_any2, but only for unique_lock<mutex>
+//*   (as std::condition_variable is for std::condition_variable_any)
+//* - blocks on a futex sequence number, so a wait uses no mutex
+//*   but the user mutex
+//* - notify_one()/notify_all() only cost one load without waiters
+//* - a stop wakes up all waiters, which re-check their predicates
+//*   (as with condition_variable_any2 in futex mode)
+//*****************************************
+class condition_variable2
+{
+  public:
+    //*****************************************
+    //* standardized API for condition_variable:
+    //*****************************************
+
+    condition_variable2() = default;
+    ~condition_variable2();
+    condition_variable2(const condition_variable2&) = delete;
+    condition_variable2& operator=(const condition_variable2&) = delete;
+
+    void notify_one() noexcept {
+        if (waiters.load(std::memory_order_relaxed) != 0) {
+            wake_one();
+        }
+    }
+    void notify_all() noexcept {
+        if (waiters.load(std::memory_order_relaxed) != 0) {
+            wake_all();
+        }
+    }
+
+    // wait()
+
+    void wait(unique_lock<mutex>& lock);
+
+    template <class Predicate>
+    void wait(unique_lock<mutex>& lock, Predicate pred) {
+        while (!pred()) {
+            wait(lock);
+        }
+    }
+
+    // wait_until()
+
+    template <class Clock, class Duration>
+    cv_status wait_until(unique_lock<mutex>& lock,
+                         const chrono::time_point<Clock, Duration>& abs_time);
+
+    template <class Clock, class Duration, class Predicate>
+    bool wait_until(unique_lock<mutex>& lock,
+                    const chrono::time_point<Clock, Duration>& abs_time,
+                    Predicate pred) {
+        while (!pred()) {
+            if (wait_until(lock, abs_time) == cv_status::timeout) {
+                return pred();
+            }
+        }
+        return true;
+    }
+
+    // wait_for()
+
+    template <class Rep, class Period>
+    cv_status wait_for(unique_lock<mutex>& lock,
+                       const chrono::duration<Rep, Period>& rel_time) {
+        return wait_until(lock, std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template <class Rep, class Period, class Predicate>
+    bool wait_for(unique_lock<mutex>& lock,
+                  const chrono::duration<Rep, Period>& rel_time,
+                  Predicate pred) {
+        return wait_until(lock, std::chrono::steady_clock::now() + rel_time, std::move(pred));
+    }
+
+    //*****************************************
+    //* supplementary API:
+    //*****************************************
+
+    // return:
+    // - true if pred() yields true
+    // - false otherwise (i.e. on interrupt)
+    template <class Predicate>
+      bool wait(unique_lock<mutex>& lock,
+                stop_token stoken,
+                Predicate pred);
+
+    // return:
+    // - true if pred() yields true
+    // - false otherwise (i.e. on timeout or interrupt)
+    template <class Clock, class Duration, class Predicate>
+      bool wait_until(unique_lock<mutex>& lock,
+                      stop_token stoken,
+                      const chrono::time_point<Clock, Duration>& abs_time,
+                      Predicate pred);
+
+    // return:
+    // - true if pred() yields true
+    // - false otherwise (i.e. on timeout or interrupt)
+    template <class Rep, class Period, class Predicate>
+      bool wait_for(unique_lock<mutex>& lock,
+                    stop_token stoken,
+                    const chrono::duration<Rep, Period>& rel_time,
+                    Predicate pred) {
+        return wait_until(lock, std::move(stoken), std::chrono::steady_clock::now() + rel_time,
+                          std::move(pred));
+      }
+
+  //*****************************************
+  //* implementation:
+  //*****************************************
+
+  private:
+    void wake_one() noexcept {
+        seq.fetch_add(1, std::memory_order_release);
+        __futex_wake_one(&seq);
+    }
+    void wake_all() noexcept {
+        seq.fetch_add(1, std::memory_order_release);
+        __futex_wake_all(&seq);
+    }
+
+    // NOTE: - the sequence number is read while the user mutex is locked,
+    //         so each notify after unlocking it changes the number
+    //         (and the futex wait returns immediately if it has changed)
+    //       - as for condition_variable_any2, waiters are counted while they use *this
+    //         (including a registered stop_callback), which ends BEFORE they relock the mutex,
+    //         and the destructor waits until the count drops to zero
+    std::atomic<std::uint32_t> seq{0};
+    std::atomic<std::uint32_t> waiters{0};   // threads using *this (+ destroying flag)
+};
+
+
+//*****************************************************************************
+//* implementation of class condition_variable2
+//*****************************************************************************
+
+inline condition_variable2::~condition_variable2()
+{
+    // wait until all notified waiters no longer use *this:
+    __drain_waiters(waiters);
+}
+
+inline void condition_variable2::wait(unique_lock<mutex>& lock)
+{
+    {
+        __waiter_guard registered(waiters);
+        const std::uint32_t s = seq.load(std::memory_order_acquire);
+        lock.unlock();
+        __futex_wait(&seq, s);
+    }
+    lock.lock();
+}
+
+template <class Clock, class Duration>
+inline cv_status condition_variable2::wait_until(unique_lock<mutex>& lock,
+                                                 const chrono::time_point<Clock, Duration>& abs_time)
+{
+    bool notified;
+    {
+        __waiter_guard registered(waiters);
+        const std::uint32_t s = seq.load(std::memory_order_acquire);
+        lock.unlock();
+        notified = __futex_wait_until(&seq, s, abs_time);
+    }
+    lock.lock();
+    return notified ? cv_status::no_timeout : cv_status::timeout;
+}
+
+// wait(): wait with interrupt handling
+// - returns on interrupt
+template <class Predicate>
+inline bool condition_variable2::wait(unique_lock<mutex>& lock,
+                                      stop_token stoken,
+                                      Predicate pred)
+{
+    if (stoken.stop_requested()) {
+      return pred();
+    }
+    while (!pred()) {
+        {
+            __waiter_guard registered(waiters);
+            const std::uint32_t s = seq.load(std::memory_order_acquire);
+            stop_callback cb(stoken, [this] { wake_all(); });
+            if (stoken.stop_requested()) {
+                // pred() has already evaluated to 'false' since we last acquired 'lock'
+                return false;
+            }
+            lock.unlock();
+            __futex_wait(&seq, s);
+        }
+        lock.lock();
+    }
+    return true;
+}
+
+// wait_until(): timed wait with interrupt handling
+// - returns on interrupt
+template <class Clock, class Duration, class Predicate>
+inline bool condition_variable2::wait_until(unique_lock<mutex>& lock,
+                                            stop_token stoken,
+                                            const chrono::time_point<Clock, Duration>& abs_time,
+                                            Predicate pred)
+{
+    if (stoken.stop_requested()) {
+      return pred();
+    }
+    while (!pred()) {
+        bool shouldStop;
+        {
+            __waiter_guard registered(waiters);
+            const std::uint32_t s = seq.load(std::memory_order_acquire);
+            stop_callback cb(stoken, [this] { wake_all(); });
+            if (stoken.stop_requested()) {
+                // pred() has already evaluated to 'false' since we last acquired 'lock'
+                return false;
+            }
+            lock.unlock();
+            shouldStop = !__futex_wait_until(&seq, s, abs_time) || stoken.stop_requested();
+        }
+        lock.lock();
+        if (shouldStop) {
+            return pred();
+        }
+    }
+    return true;
+}
+
+
+} // std
+
+#endif // CONDITION_VARIABLE2_MUTEX_HPP
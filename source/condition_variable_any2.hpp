@@ -8,8 +8,15 @@
 // forward declarations are in separate header due to cyclic type dependencies:
 //*****************************************************************************
 #include "stop_token.hpp"
+#include "futex.hpp"
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 namespace std {
 
@@ -17,82 +24,478 @@ namespace std {
 //***************************************** 
 //* class condition_variable_any2
 //* - joining std::thread with interrupt support 
+//* - each waiter blocks on its own wait node,
+//*   so a stop wakes up only the waiter(s) using the stopped stop_token
+//* - notify_one() wakes up the oldest waiter (fair),
+//*   compile with -DCV_ANY2_LIFO to wake up the newest waiter first instead
+//*   (its data is most likely still in the cache, but old waiters might starve)
+//* - compile with -DCV_ANY2_FUTEX to block on a shared futex sequence number
+//*   instead of an internal mutex and wait nodes
+//*   (then a stop wakes up all waiters, which re-check their predicates)
+//*   (Linux; elsewhere futex.hpp falls back to hashed condition variables)
+//* - compile with -DCV_ANY2_SPIN to spin for a while before blocking (see spin_until())
 //***************************************** 
 class condition_variable_any2
 {
+    // unlocks the user lock only on request and relocks it on destruction
+    // (so that the internals can be released before the user lock is reacquired):
     template<typename Lockable>
-    struct unlock_guard{
-        unlock_guard(Lockable& mtx_):
+    struct relock_guard{
+        relock_guard(Lockable& mtx_):
             mtx(mtx_){
+        }
+        void unlock(){
             mtx.unlock();
+            unlocked = true;
         }
-        ~unlock_guard(){
-            mtx.lock();
+        ~relock_guard(){
+            if (unlocked) {
+                mtx.lock();
+            }
         }
-        unlock_guard(unlock_guard const&)=delete;
-        unlock_guard(unlock_guard&&)=delete;
-        unlock_guard& operator=(unlock_guard const&)=delete;
-        unlock_guard& operator=(unlock_guard&&)=delete;
-        
+        relock_guard(relock_guard const&)=delete;
+        relock_guard(relock_guard&&)=delete;
+        relock_guard& operator=(relock_guard const&)=delete;
+        relock_guard& operator=(relock_guard&&)=delete;
+
     private:
         Lockable& mtx;
+        bool unlocked = false;
+    };
+
+    // wait morphing is used for the common lock types,
+    // for which the user lock is a plain mutex:
+    template<typename Lockable>
+    static constexpr bool morphs = std::is_same_v<Lockable, std::unique_lock<std::mutex>>
+                                   || std::is_same_v<Lockable, std::mutex>;
+
+    // the user mutex (only waiters sharing it can pass the turn on to each other):
+    template<typename Lockable>
+    static const void* user_mutex(Lockable& lock){
+        if constexpr (std::is_same_v<Lockable, std::unique_lock<std::mutex>>) {
+            return lock.mutex();
+        }
+        else if constexpr (std::is_same_v<Lockable, std::mutex>) {
+            return &lock;
+        }
+        else {
+            return nullptr;
+        }
+    }
+
+    // optional spinning before blocking (-DCV_ANY2_SPIN):
+    // - after releasing the user lock a waiter polls its futex word for a while,
+    //   which also sees a stop (the stop_callback notifies the waiter)
+    // - the predicate is not called while spinning (it requires the user lock),
+    //   but re-checked as usual after the user lock is reacquired
+    // - the number of iterations adapts to how long the previous waits of the thread took
+    //   (per thread, because notified waiters must no longer use the internals),
+    //   bounded by CV_ANY2_SPIN_MAX
+    // - no spinning with only one hardware thread (nobody could notify meanwhile)
+    // return: whether done() yielded true before the spinning ended
+#ifdef CV_ANY2_SPIN
+#ifndef CV_ANY2_SPIN_MAX
+#define CV_ANY2_SPIN_MAX 4000
+#endif
+    template<typename Done>
+    static bool spin_until(Done done){
+        static const bool multicore = std::thread::hardware_concurrency() > 1;
+        if (!multicore) {
+            return false;
+        }
+        thread_local int estimate = 0;
+        const int limit = std::min(2 * estimate + 64, CV_ANY2_SPIN_MAX);
+        for (int i = 0; i < limit; ++i) {
+            if (done()) {
+                estimate += (i - estimate) / 8;
+                return true;
+            }
+            __spin_yield();
+        }
+        estimate -= estimate / 8;
+        return false;
+    }
+    template<typename Done, class Clock, class Duration>
+    static bool spin_until(Done done, const chrono::time_point<Clock, Duration>& abs_time){
+        return Clock::now() < abs_time && spin_until(std::move(done));
+    }
+#else
+    template<typename Done>
+    static bool spin_until(Done){
+        return false;
+    }
+    template<typename Done, class Clock, class Duration>
+    static bool spin_until(Done, const chrono::time_point<Clock, Duration>&){
+        return false;
+    }
+#endif
+
+#if defined(CV_ANY2_FUTEX) && defined(CV_ANY2_LIFO)
+#error "CV_ANY2_LIFO requires the wait nodes of the default mode (not CV_ANY2_FUTEX)"
+#endif
+#ifdef CV_ANY2_FUTEX
+    // futex mode: no internal mutex, waiters block on a sequence number
+    // - the sequence number is read while the user lock is held,
+    //   so each notify after unlocking the user lock changes it
+    //   (and the futex wait returns immediately if it has changed)
+    // - there is no wait morphing (notify_all() wakes up all waiters at once)
+    struct wait_node{
+    };
+    struct handoff_guard{
+        explicit handoff_guard(const void* = nullptr){
+        }
     };
 
     struct cv_internals{
-        std::mutex m = {};
-        std::condition_variable cv = {};
+        std::atomic<std::uint32_t> waiters{0};   // threads using internals (+ destroying flag)
+        std::atomic<std::uint32_t> seq{0};
+
+        // registered waiter with the sequence number to wait for a change of:
+        struct ticket{
+            ticket(cv_internals& internals_):
+                registered(internals_.waiters), seq(internals_.seq.load(std::memory_order_acquire)){
+            }
+            __waiter_guard registered;
+            std::uint32_t seq;
+        };
 
+        ticket prepare_wait(handoff_guard*, wait_node* = nullptr){
+            return ticket(*this);
+        }
+        void wait(ticket& t){
+            if (spin_until([&] { return changed(t); })) {
+                return;
+            }
+            __futex_wait(&seq, t.seq);
+        }
+        template<class Clock, class Duration>
+        cv_status wait_until(ticket& t, const chrono::time_point<Clock, Duration>& abs_time){
+            if (spin_until([&] { return changed(t); }, abs_time)) {
+                return cv_status::no_timeout;
+            }
+            return __futex_wait_until(&seq, t.seq, abs_time) ? cv_status::no_timeout : cv_status::timeout;
+        }
+        bool changed(const ticket& t) const{
+            return seq.load(std::memory_order_acquire) != t.seq;
+        }
         void notify_all(){
-            std::lock_guard<std::mutex> guard(m);
-            cv.notify_all();
+            seq.fetch_add(1, std::memory_order_release);
+            __futex_wake_all(&seq);
         }
         void notify_one(){
+            seq.fetch_add(1, std::memory_order_release);
+            __futex_wake_one(&seq);
+        }
+        void notify_n(std::size_t count){
+            seq.fetch_add(1, std::memory_order_release);
+            __futex_wake(&seq, static_cast<int>(std::min<std::size_t>(count, INT_MAX)));
+        }
+        // wake up the waiter of a ticket or wait node (on stop):
+        // - as all waiters share the sequence number, this wakes up all of them
+        void notify_waiter(ticket&){
+            notify_all();
+        }
+        void notify_waiter(wait_node&){
+            notify_all();
+        }
+    };
+#else
+    // default mode: each waiter blocks on the futex word of its own wait node
+    // - the nodes live on the stacks of the waiters and are linked into a list
+    //   guarded by the internal mutex
+    // - notifiers unlink (claim) the nodes under the mutex but mark them as notified
+    //   and wake them up only after releasing it, so that woken threads don't block on
+    //   the mutex and the notifier no longer uses the internals when a waiter returns
+    // - thus, a stop wakes up only the waiter the stop_token belongs to
+    // - notify_all() (and notify_n()) wakes up waiters with a plain mutex as user lock one after the other
+    //   (wait morphing): each of them wakes up the next one after it has reacquired the mutex,
+    //   so that the mutex isn't contended by all of them at once
+    //   - chained waiters no longer use the internals, so they are no longer counted as waiters
+    //     (the condition variable might be destroyed while they are still waiting for their turn)
+    //   - only untimed waits without stop_token are chained
+    //     (a timeout or stop_callback would still use the internals)
+    //   - only waiters with the same mutex as the first chained waiter are chained,
+    //     the others are woken up directly
+    //     (a waiter can't acquire its mutex while another mutex is still held by someone else)
+    struct wait_node{
+        enum : std::uint32_t { idle, waiting, claimed, notified };
+        std::atomic<std::uint32_t> state{idle};
+        wait_node* prev = nullptr;
+        wait_node* next = nullptr;
+        bool chainable = false;          // notify_all() may chain this waiter
+        const void* mutex = nullptr;     // user mutex of a chainable waiter
+        bool chained = false;            // woken up as part of a notify_all() chain
+        wait_node* successor = nullptr;  // chained waiter to wake up next
+    };
+
+    // wakes up the next waiter of a notify_all() chain once the user lock is reacquired:
+    struct handoff_guard{
+        explicit handoff_guard(const void* mutex_ = nullptr):
+            mutex(mutex_){
+        }
+        ~handoff_guard(){
+            if (next != nullptr) {
+                wake(*next);
+            }
+        }
+        handoff_guard(handoff_guard const&)=delete;
+        handoff_guard& operator=(handoff_guard const&)=delete;
+
+        const void* mutex;             // user mutex of the waiter
+        wait_node* next = nullptr;
+    };
+
+    // once marked as notified the node might be destroyed immediately
+    // (waking up a destroyed futex address is fine):
+    static void wake(wait_node& n){
+        n.state.store(wait_node::notified, std::memory_order_release);
+        __futex_wake_one(&n.state);
+    }
+
+    struct cv_internals{
+        std::atomic<std::uint32_t> waiters{0};   // threads using internals (+ destroying flag)
+        std::mutex m = {};
+        wait_node* head = nullptr;   // newest waiter
+        wait_node* tail = nullptr;   // oldest waiter
+
+        // registers the waiter and links a wait node into the list on construction,
+        // unlinks it on destruction
+        // (either its own node or one reused for many waits):
+        struct ticket{
+            ticket(cv_internals& internals_, handoff_guard* handoff_, wait_node* reused):
+                internals(internals_), registered(internals_.waiters),
+                node(reused != nullptr ? *reused : own), handoff(handoff_){
+                node.chainable = (handoff != nullptr);
+                node.mutex = (handoff != nullptr ? handoff->mutex : nullptr);
+                internals.link(node);
+            }
+            ~ticket(){
+                internals.unlink_or_await(node);
+                if (node.chained) {
+                    // released by the notifier, pass the turn on after relocking:
+                    registered.__dismiss();
+                    handoff->next = node.successor;
+                }
+            }
+            ticket(ticket const&)=delete;
+            ticket& operator=(ticket const&)=delete;
+
+            cv_internals& internals;
+            __waiter_guard registered;
+            wait_node own;
+            wait_node& node;
+            handoff_guard* handoff;   // only for chainable waiters
+        };
+
+        ticket prepare_wait(handoff_guard* handoff, wait_node* reused = nullptr){
+            return ticket(*this, handoff, reused);
+        }
+        void wait(ticket& t){
+            if (spin_until([&] { return notified(t); })) {
+                return;
+            }
+            std::uint32_t st;
+            while ((st = t.node.state.load(std::memory_order_acquire)) != wait_node::notified) {
+                __futex_wait(&t.node.state, st);
+            }
+        }
+        template<class Clock, class Duration>
+        cv_status wait_until(ticket& t, const chrono::time_point<Clock, Duration>& abs_time){
+            if (spin_until([&] { return notified(t); }, abs_time)) {
+                return cv_status::no_timeout;
+            }
+            std::uint32_t st;
+            while ((st = t.node.state.load(std::memory_order_acquire)) != wait_node::notified) {
+                if (!__futex_wait_until(&t.node.state, st, abs_time)) {
+                    return t.node.state.load(std::memory_order_acquire) == wait_node::notified
+                             ? cv_status::no_timeout : cv_status::timeout;
+                }
+            }
+            return cv_status::no_timeout;
+        }
+        static bool notified(const ticket& t){
+            return t.node.state.load(std::memory_order_acquire) == wait_node::notified;
+        }
+        void notify_all(){
+            notify_n(SIZE_MAX);
+        }
+        // claims up to count waiters in one critical section:
+        void notify_n(std::size_t count){
+            wait_node* n;
+            wait_node* chain = nullptr;
+            std::uint32_t numChained = 0;
+            std::size_t numClaimed = 0;
+            {
+                std::lock_guard<std::mutex> guard(m);
+                n = first();
+                wait_node* last = nullptr;
+                wait_node* c = n;
+                for (; c != nullptr && numClaimed < count; c = following(*c), ++numClaimed) {
+                    c->state.store(wait_node::claimed, std::memory_order_relaxed);
+                    if (c->chainable && (chain == nullptr || c->mutex == chain->mutex)) {
+                        c->chained = true;
+                        (last != nullptr ? last->successor : chain) = c;
+                        last = c;
+                        ++numChained;
+                    }
+                }
+                cut_before(c);
+            }
+            // claimed nodes stay alive until they are notified, so we can still follow the links:
+            for (; numClaimed > 0; --numClaimed) {
+                wait_node* after = following(*n);
+                if (!n->chained) {
+                    wake(*n);
+                }
+                n = after;
+            }
+            if (chain != nullptr) {
+                // afterwards *this might be destroyed:
+                __release_waiters(waiters, numChained);
+                wake(*chain);
+            }
+        }
+        void notify_one(){
+            wait_node* n;
+            {
+                std::lock_guard<std::mutex> guard(m);
+                n = first();
+                if (n == nullptr) {
+                    return;
+                }
+                remove(*n);
+                n->state.store(wait_node::claimed, std::memory_order_relaxed);
+            }
+            wake(*n);
+        }
+        // wake up the waiter of a ticket or wait node (on stop) unless it is not waiting
+        // (only waiting nodes are linked):
+        void notify_waiter(ticket& t){
+            notify_waiter(t.node);
+        }
+        void notify_waiter(wait_node& n){
+            {
+                std::lock_guard<std::mutex> guard(m);
+                if (n.state.load(std::memory_order_relaxed) != wait_node::waiting) {
+                    return;
+                }
+                remove(n);
+                n.state.store(wait_node::claimed, std::memory_order_relaxed);
+            }
+            wake(n);
+        }
+
+    private:
+#ifdef CV_ANY2_LIFO
+        // the newest waiter is woken up first (its data is most likely still in the cache):
+        wait_node* first() const{
+            return head;
+        }
+        static wait_node* following(wait_node& n){
+            return n.next;
+        }
+        // requires m to be locked, removes the waiters woken up before n:
+        void cut_before(wait_node* n){
+            head = n;
+            (n != nullptr ? n->prev : tail) = nullptr;
+        }
+#else
+        // the oldest waiter is woken up first (fair):
+        wait_node* first() const{
+            return tail;
+        }
+        static wait_node* following(wait_node& n){
+            return n.prev;
+        }
+        // requires m to be locked, removes the waiters woken up before n:
+        void cut_before(wait_node* n){
+            tail = n;
+            (n != nullptr ? n->next : head) = nullptr;
+        }
+#endif
+        // requires m to be locked:
+        void remove(wait_node& n){
+            (n.prev != nullptr ? n.prev->next : head) = n.next;
+            (n.next != nullptr ? n.next->prev : tail) = n.prev;
+        }
+        void link(wait_node& n){
             std::lock_guard<std::mutex> guard(m);
-            cv.notify_one();
+            n.state.store(wait_node::waiting, std::memory_order_relaxed);
+            n.chained = false;
+            n.successor = nullptr;
+            n.prev = nullptr;
+            n.next = head;
+            (head != nullptr ? head->prev : tail) = &n;
+            head = &n;
+        }
+        // end of a wait (notified, timeout, stop, or exception):
+        void unlink_or_await(wait_node& n){
+            if (n.state.load(std::memory_order_acquire) == wait_node::notified) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> guard(m);
+                if (n.state.load(std::memory_order_relaxed) == wait_node::waiting) {
+                    remove(n);
+                    // a reused node must not look linked to a later notify_waiter() (stop_waiter):
+                    n.state.store(wait_node::idle, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            // claimed by a notifier, which is about to wake us up:
+            std::uint32_t st;
+            while ((st = n.state.load(std::memory_order_acquire)) != wait_node::notified) {
+                __futex_wait(&n.state, st);
+            }
         }
     };
+#endif
     
   public:
     //***************************************** 
     //* standardized API for condition_variable_any:
     //***************************************** 
 
-    condition_variable_any2()
-        : internals{std::make_shared<cv_internals>()} {
-    }
+    condition_variable_any2() = default;
     ~condition_variable_any2() {
+        // wait until all notified waiters no longer use the internals
+        // (see the note at the end of the class):
+        __drain_waiters(internals.waiters);
     }
     condition_variable_any2(const condition_variable_any2&) = delete;
     condition_variable_any2& operator=(const condition_variable_any2&) = delete;
 
+    // without waiters notifying costs only one load:
+    // - waiters register before they release the user lock,
+    //   so state changes done under this lock are followed by a load that sees them
     void notify_one() noexcept {
-        internals->notify_one();
+        if (internals.waiters.load(std::memory_order_relaxed) != 0) {
+            internals.notify_one();
+        }
     }
     void notify_all() noexcept {
-        internals->notify_all();
+        if (internals.waiters.load(std::memory_order_relaxed) != 0) {
+            internals.notify_all();
+        }
     }
 
     // wait()
 
     template<typename Lockable>
     void wait(Lockable& lock) {
-        auto local_internals=internals;
-        std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
-        unlock_guard<Lockable> unlocker(lock);
-        std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-        local_internals->cv.wait(second_internal_lock);
+        handoff_guard handoff{user_mutex(lock)};
+        relock_guard<Lockable> relocker(lock);
+        auto ticket = internals.prepare_wait(morphs<Lockable> ? &handoff : nullptr);
+        relocker.unlock();
+        internals.wait(ticket);
     }
 
     template<class Lockable,class Predicate>
     void wait(Lockable& lock, Predicate pred) {
         // have to manually implement the loop so that the user-provided lock is reacquired before calling pred().
         // (otherwise the test_cvrace_pred test case fails)
-        auto local_internals=internals;
         while (!pred()) {
-          std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
-          unlock_guard<Lockable> unlocker(lock);
-          std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-          local_internals->cv.wait(second_internal_lock);
+          wait(lock);
         }
     }
 
@@ -101,11 +504,10 @@ class condition_variable_any2
     template<class Lockable, class Clock, class Duration>
      cv_status wait_until(Lockable& lock,
                           const chrono::time_point<Clock, Duration>& abs_time) {
-        auto local_internals=internals;
-        std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
-        unlock_guard<Lockable> unlocker(lock);
-        std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-        return local_internals->cv.wait_until(second_internal_lock, abs_time);
+        relock_guard<Lockable> relocker(lock);
+        auto ticket = internals.prepare_wait(nullptr);
+        relocker.unlock();
+        return internals.wait_until(ticket, abs_time);
     }
 
     template<class Lockable,class Clock, class Duration, class Predicate>
@@ -114,16 +516,8 @@ class condition_variable_any2
                     Predicate pred) {
         // have to manually implement the loop so that the user-provided lock is reacquired before calling pred().
         // (otherwise the test_cvrace_pred test case fails)
-        auto local_internals=internals;
         while (!pred()) {
-            bool shouldStop;
-            {
-                std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
-                unlock_guard<Lockable> unlocker(lock);
-                std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-                shouldStop = (local_internals->cv.wait_until(second_internal_lock, abs_time) == std::cv_status::timeout);
-            }
-            if (shouldStop) {
+            if (wait_until(lock, abs_time) == std::cv_status::timeout) {
                 return pred();
             }
         }
@@ -149,6 +543,15 @@ class condition_variable_any2
     //* supplementary API:
     //***************************************** 
 
+    // wakes up count waiters (or all if there are fewer) with one internal critical section
+    // (e.g. after pushing count items instead of calling notify_one() count times)
+    // - in futex mode, as with notify_one(), waiters that did not block yet also return
+    void notify_n(std::size_t count) noexcept {
+        if (count != 0 && internals.waiters.load(std::memory_order_relaxed) != 0) {
+            internals.notify_n(count);
+        }
+    }
+
     // x.6.2.1 dealing with interrupts:
 
     // return:
@@ -176,13 +579,15 @@ class condition_variable_any2
                     const chrono::duration<Rep, Period>& rel_time,
                     Predicate pred);
 
+    // x.6.2.2 repeated waits with the same stop_token:
+    class stop_waiter;
+
   //***************************************** 
   //* implementation:
   //***************************************** 
 
   private:
-    //*** API for the starting thread:
-    std::shared_ptr<cv_internals> internals;
+    cv_internals internals;
      // NOTE (as Howard Hinnant pointed out): 
      // std::~condition_variable_any() says:
      //   Requires: There shall be no thread blocked on *this. [Note: That is, all threads shall have been notified;
@@ -194,16 +599,76 @@ class condition_variable_any2
      //             wait, wait_for, or wait_until that take a predicate.  ]
      // That big long note means ~condition_variable_any() can execute before a signaled thread returns from a wait.
      // If this happens with condition_variable_any2, that waiting thread will attempt to lock the destructed mutex mut.
-     // To fix this, there must be shared ownership of the data member mut between the condition_variable_any object
-     // and the member functions wait (wait_for, etc.).
-     // (libc++'s implementation gets this right: https://github.com/llvm-mirror/libcxx/blob/master/include/condition_variable
-     //  It holds the data member mutex with a shared_ptr<mutex> instead of mutex directly, and the wait functions create 
+     // (libc++'s implementation holds the mutex with a shared_ptr<mutex>, and the wait functions create
      //  a local shared_ptr<mutex> copy on entry so that if *this destructs out from under the thread executing the wait function,
-     //  the mutex stays alive until the wait function returns.)
+     //  the mutex stays alive until the wait function returns.
+     //  But that costs two atomic reference count updates on a shared control block per wait.)
+     // Instead, waiters are counted while they use the internals (including a registered stop_callback),
+     // which ends BEFORE they reacquire the user lock, and the destructor waits until the count drops to zero.
+     // (Waiters chained by notify_all() are released by the notifier, as they only wait for their predecessor.)
+     // Thus, the destructor might even be called with the user lock held.
 };
 
 
 
+//***************************************** 
+//* class condition_variable_any2::stop_waiter
+//* - stop-aware waits on a condition variable with the same stop_token
+//*   (registers the stop_token only once instead of once per blocking wait)
+//* - waits return false if stop was requested (as the waits with a stop_token do)
+//* - only one thread at a time may wait with the same stop_waiter
+//* - has to be destroyed before the condition variable
+//*   (even if the condition variable is destroyed while its waiters are notified)
+//***************************************** 
+class condition_variable_any2::stop_waiter
+{
+  public:
+    stop_waiter(condition_variable_any2& cv_, stop_token stoken_)
+     : cv(cv_), stoken(std::move(stoken_)), cb(stoken, waker{this}) {
+    }
+    stop_waiter(const stop_waiter&) = delete;
+    stop_waiter& operator=(const stop_waiter&) = delete;
+
+    // return:
+    // - true if pred() yields true
+    // - false otherwise (i.e. on interrupt)
+    template <class Lockable, class Predicate>
+      bool wait(Lockable& lock, Predicate pred);
+
+    // return:
+    // - true if pred() yields true
+    // - false otherwise (i.e. on timeout or interrupt)
+    template <class Lockable, class Clock, class Duration, class Predicate>
+      bool wait_until(Lockable& lock,
+                      const chrono::time_point<Clock, Duration>& abs_time,
+                      Predicate pred);
+    template <class Lockable, class Rep, class Period, class Predicate>
+      bool wait_for(Lockable& lock,
+                    const chrono::duration<Rep, Period>& rel_time,
+                    Predicate pred) {
+        return wait_until(lock, std::chrono::steady_clock::now() + rel_time, std::move(pred));
+      }
+
+    [[nodiscard]] stop_token get_token() const noexcept {
+        return stoken;
+    }
+
+  private:
+    // wakes up the current wait (if any) on stop:
+    struct waker{
+        stop_waiter* self;
+        void operator()() noexcept {
+            self->cv.internals.notify_waiter(self->node);
+        }
+    };
+
+    condition_variable_any2& cv;
+    stop_token stoken;
+    wait_node node;            // reused for all waits
+    stop_callback<waker> cb;   // last member, so that it is deregistered first
+};
+
+
 //*****************************************************************************
 //* implementation of class condition_variable_any2
 //*****************************************************************************
@@ -221,17 +686,18 @@ inline bool condition_variable_any2::wait(Lockable& lock,
     if (stoken.stop_requested()) {
       return pred();
     }
-    auto local_internals=internals;
-    stop_callback cb(stoken, [&local_internals] { local_internals->notify_all(); });
     while (!pred()) {
-        std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
+        relock_guard<Lockable> relocker(lock);
+        auto ticket = internals.prepare_wait(nullptr);
+        // registered per blocking wait, so that the callback no longer uses
+        // the internals when the user lock is reacquired (see destructor):
+        stop_callback cb(stoken, [this, &ticket] { internals.notify_waiter(ticket); });
         if (stoken.stop_requested()) {
-            // pred() has already evaluated to 'false' since we last a acquired 'lock'
+            // pred() has already evaluated to 'false' since we last acquired 'lock'
             return false;
         }
-        unlock_guard<Lockable> unlocker(lock);
-        std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-        local_internals->cv.wait(second_internal_lock);
+        relocker.unlock();
+        internals.wait(ticket);
     }
 
     return true;
@@ -253,19 +719,18 @@ inline bool condition_variable_any2::wait_until(Lockable& lock,
     }
     // have to manually implement the loop so that the user-provided lock is reacquired before calling pred().
     // (otherwise the test_cvrace_pred test case fails)
-    auto local_internals=internals;
-    stop_callback cb(stoken, [&local_internals] { local_internals->notify_all(); });
     while (!pred()) {
         bool shouldStop;
         {
-            std::unique_lock<std::mutex> first_internal_lock(local_internals->m);
+            relock_guard<Lockable> relocker(lock);
+            auto ticket = internals.prepare_wait(nullptr);
+            stop_callback cb(stoken, [this, &ticket] { internals.notify_waiter(ticket); });
             if (stoken.stop_requested()) {
                 // pred() has already evaluated to 'false' since we last acquired 'lock'.
                 return false;
             }
-            unlock_guard<Lockable> unlocker(lock);
-            std::unique_lock<std::mutex> second_internal_lock(std::move(first_internal_lock));
-            const auto status = local_internals->cv.wait_until(second_internal_lock, abs_time);
+            relocker.unlock();
+            const auto status = internals.wait_until(ticket, abs_time);
             shouldStop = (status == std::cv_status::timeout) || stoken.stop_requested();
         }
         if (shouldStop) {
@@ -294,6 +759,62 @@ inline bool condition_variable_any2::wait_for(Lockable& lock,
 }
 
 
+//*****************************************************************************
+//* implementation of class condition_variable_any2::stop_waiter
+//*****************************************************************************
+
+// NOTE: the stop_callback wakes up the reused wait node only while it is linked,
+//       so each wait checks for a stop after linking it
+
+template <class Lockable, class Predicate>
+inline bool condition_variable_any2::stop_waiter::wait(Lockable& lock,
+                                                       Predicate pred)
+{
+    if (stoken.stop_requested()) {
+      return pred();
+    }
+    while (!pred()) {
+        relock_guard<Lockable> relocker(lock);
+        auto ticket = cv.internals.prepare_wait(nullptr, &node);
+        if (stoken.stop_requested()) {
+            // pred() has already evaluated to 'false' since we last acquired 'lock'
+            return false;
+        }
+        relocker.unlock();
+        cv.internals.wait(ticket);
+    }
+    return true;
+}
+
+template <class Lockable, class Clock, class Duration, class Predicate>
+inline bool condition_variable_any2::stop_waiter::wait_until(Lockable& lock,
+                                                             const chrono::time_point<Clock, Duration>& abs_time,
+                                                             Predicate pred)
+{
+    if (stoken.stop_requested()) {
+      return pred();
+    }
+    while (!pred()) {
+        bool shouldStop;
+        {
+            relock_guard<Lockable> relocker(lock);
+            auto ticket = cv.internals.prepare_wait(nullptr, &node);
+            if (stoken.stop_requested()) {
+                // pred() has already evaluated to 'false' since we last acquired 'lock'.
+                return false;
+            }
+            relocker.unlock();
+            const auto status = cv.internals.wait_until(ticket, abs_time);
+            shouldStop = (status == std::cv_status::timeout) || stoken.stop_requested();
+        }
+        if (shouldStop) {
+            return pred();
+        }
+    }
+    return true;
+}
+
+
 } // std
 
 #endif // CONDITION_VARIABLE2_HPP
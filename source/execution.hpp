@@ -0,0 +1,786 @@
+// -----------------------------------------------------
+// minimal sender/receiver layer with stop_token propagation:
+// -----------------------------------------------------
+#ifndef EXECUTION_HPP
+#define EXECUTION_HPP
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include "jthread.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace std {
+namespace execution {
+
+//*****************************************
+//* protocol:
+//* - a sender describes asynchronous work completing with at most one value:
+//*   - value_type is the type of the value (or void)
+//*   - std::move(sndr).connect(rcvr) returns an operation state, which
+//*     starts the work with start() (noexcept) and must neither be moved
+//*     nor destroyed before it completed
+//* - a receiver gets exactly one of the following (noexcept) calls:
+//*   - set_value() or set_value(value)
+//*   - set_error(exception_ptr)
+//*   - set_stopped()
+//*   and provides the stop_token of its environment by get_stop_token()
+//* - operation states of child senders are stored in the operation states
+//*   of their parents, so that composing senders doesn't allocate
+//*****************************************
+
+template <typename _Sender>
+using __value_t = typename std::decay_t<_Sender>::value_type;
+
+template <typename _Sender, typename _Receiver>
+using connect_result_t = decltype(std::declval<_Sender>().connect(std::declval<_Receiver>()));
+
+// type to store the value of a sender completing with void:
+template <typename _T>
+using __non_void_t = std::conditional_t<std::is_void_v<_T>, std::monostate, _T>;
+
+// result of passing the value (if any) to a callable:
+template <typename _F, typename _T>
+struct __call_result {
+  using type = std::invoke_result_t<_F&, _T>;
+};
+template <typename _F>
+struct __call_result<_F, void> {
+  using type = std::invoke_result_t<_F&>;
+};
+
+// holds a non-movable operation state initialized in place with the prvalue
+// returned by a callable (a member initialized from a prvalue is guaranteed to
+// be elided by every compiler, a conversion operator returning it is not);
+// _Tag distinguishes several bases of the same type
+template <typename _T, std::size_t _Tag = 0>
+struct __in_place_from {
+  template <typename _Fn>
+  explicit __in_place_from(_Fn&& __fn)
+   : __value_(std::forward<_Fn>(__fn)()) {
+  }
+  __in_place_from(const __in_place_from&) = delete;
+  __in_place_from& operator=(const __in_place_from&) = delete;
+  _T __value_;
+};
+
+// stop callback forwarding a stop request to an inplace_stop_source:
+struct __forward_stop {
+  inplace_stop_source* __src_;
+  void operator()() const noexcept {
+    __src_->request_stop();
+  }
+};
+
+
+//*****************************************
+//* just()
+//* - sender completing with the passed value (or with void)
+//*****************************************
+template <typename _T>
+struct __just_sender {
+  using value_type = _T;
+
+  template <typename _Receiver>
+  struct __op {
+    _T __value_;
+    _Receiver __rcvr_;
+    void start() noexcept {
+      __rcvr_.set_value(std::move(__value_));
+    }
+  };
+
+  template <typename _Receiver>
+  __op<_Receiver> connect(_Receiver __r) && {
+    return __op<_Receiver>{std::move(__value_), std::move(__r)};
+  }
+
+  _T __value_;
+};
+
+template <>
+struct __just_sender<void> {
+  using value_type = void;
+
+  template <typename _Receiver>
+  struct __op {
+    _Receiver __rcvr_;
+    void start() noexcept {
+      __rcvr_.set_value();
+    }
+  };
+
+  template <typename _Receiver>
+  __op<_Receiver> connect(_Receiver __r) && {
+    return __op<_Receiver>{std::move(__r)};
+  }
+};
+
+inline __just_sender<void> just() noexcept {
+  return {};
+}
+
+template <typename T>
+__just_sender<std::decay_t<T>> just(T&& value) {
+  return __just_sender<std::decay_t<T>>{std::forward<T>(value)};
+}
+
+
+//*****************************************
+//* then()
+//* - passes the value of a sender to a callable and completes with its result
+//* - exceptions of the callable complete with set_error()
+//*****************************************
+template <typename _Sender, typename _F>
+struct __then_sender {
+  using value_type = typename __call_result<_F, __value_t<_Sender>>::type;
+
+  template <typename _Receiver>
+  struct __rcvr {
+    _Receiver __rcvr_;
+    _F __fn_;
+
+    template <typename... _Vs>
+    void set_value(_Vs&&... __vs) noexcept {
+      try {
+        if constexpr (std::is_void_v<value_type>) {
+          std::invoke(__fn_, std::forward<_Vs>(__vs)...);
+          __rcvr_.set_value();
+        }
+        else {
+          __rcvr_.set_value(std::invoke(__fn_, std::forward<_Vs>(__vs)...));
+        }
+      }
+      catch (...) {
+        __rcvr_.set_error(std::current_exception());
+      }
+    }
+    void set_error(std::exception_ptr __e) noexcept {
+      __rcvr_.set_error(std::move(__e));
+    }
+    void set_stopped() noexcept {
+      __rcvr_.set_stopped();
+    }
+    stop_token get_stop_token() const noexcept {
+      return __rcvr_.get_stop_token();
+    }
+  };
+
+  template <typename _Receiver>
+  auto connect(_Receiver __r) && {
+    return std::move(__sndr_).connect(__rcvr<_Receiver>{std::move(__r), std::move(__fn_)});
+  }
+
+  _Sender __sndr_;
+  _F __fn_;
+};
+
+template <typename Sender, typename F>
+__then_sender<std::decay_t<Sender>, std::decay_t<F>> then(Sender&& sndr, F&& fn) {
+  return {std::forward<Sender>(sndr), std::forward<F>(fn)};
+}
+
+
+//*****************************************
+//* let_value()
+//* - passes the value of a sender to a callable returning another sender,
+//*   which is started then (the value lives until the second sender completes)
+//*****************************************
+template <typename _Sender, typename _F>
+struct __let_value_sender {
+  using __arg_t = __value_t<_Sender>;
+  using __sender2_t = std::decay_t<typename __call_result<_F, std::add_lvalue_reference_t<__arg_t>>::type>;
+  using value_type = __value_t<__sender2_t>;
+
+  template <typename _Receiver>
+  struct __op;
+
+  // receiver for the first sender:
+  template <typename _Receiver>
+  struct __rcvr1 {
+    __op<_Receiver>* __op_;
+
+    template <typename... _Vs>
+    void set_value(_Vs&&... __vs) noexcept {
+      __op_->__continue(std::forward<_Vs>(__vs)...);
+    }
+    void set_error(std::exception_ptr __e) noexcept {
+      __op_->__rcvr_.set_error(std::move(__e));
+    }
+    void set_stopped() noexcept {
+      __op_->__rcvr_.set_stopped();
+    }
+    stop_token get_stop_token() const noexcept {
+      return __op_->__rcvr_.get_stop_token();
+    }
+  };
+
+  // receiver for the sender returned by the callable:
+  template <typename _Receiver>
+  struct __rcvr2 {
+    __op<_Receiver>* __op_;
+
+    template <typename... _Vs>
+    void set_value(_Vs&&... __vs) noexcept {
+      __op_->__rcvr_.set_value(std::forward<_Vs>(__vs)...);
+    }
+    void set_error(std::exception_ptr __e) noexcept {
+      __op_->__rcvr_.set_error(std::move(__e));
+    }
+    void set_stopped() noexcept {
+      __op_->__rcvr_.set_stopped();
+    }
+    stop_token get_stop_token() const noexcept {
+      return __op_->__rcvr_.get_stop_token();
+    }
+  };
+
+  template <typename _Receiver>
+  struct __op {
+    __op(_Sender&& __s, _F&& __f, _Receiver&& __r)
+     : __fn_{std::move(__f)}, __rcvr_{std::move(__r)},
+       __op1_{std::move(__s).connect(__rcvr1<_Receiver>{this})} {
+    }
+    __op(const __op&) = delete;
+    __op& operator=(const __op&) = delete;
+
+    void start() noexcept {
+      __op1_.start();
+    }
+
+    template <typename... _Vs>
+    void __continue(_Vs&&... __vs) noexcept {
+      try {
+        auto& __arg = __value_.emplace(std::forward<_Vs>(__vs)...);
+        __op2_.emplace([&] {
+                         if constexpr (std::is_void_v<__arg_t>) {
+                           (void)__arg;
+                           return std::invoke(__fn_).connect(__rcvr2<_Receiver>{this});
+                         }
+                         else {
+                           return std::invoke(__fn_, __arg).connect(__rcvr2<_Receiver>{this});
+                         }
+                       });
+      }
+      catch (...) {
+        __rcvr_.set_error(std::current_exception());
+        return;
+      }
+      __op2_->__value_.start();
+    }
+
+    _F __fn_;
+    _Receiver __rcvr_;
+    std::optional<__non_void_t<__arg_t>> __value_;
+    connect_result_t<_Sender, __rcvr1<_Receiver>> __op1_;
+    std::optional<__in_place_from<connect_result_t<__sender2_t, __rcvr2<_Receiver>>>> __op2_;
+  };
+
+  template <typename _Receiver>
+  __op<_Receiver> connect(_Receiver __r) && {
+    return __op<_Receiver>{std::move(__sndr_), std::move(__fn_), std::move(__r)};
+  }
+
+  _Sender __sndr_;
+  _F __fn_;
+};
+
+template <typename Sender, typename F>
+__let_value_sender<std::decay_t<Sender>, std::decay_t<F>> let_value(Sender&& sndr, F&& fn) {
+  return {std::forward<Sender>(sndr), std::forward<F>(fn)};
+}
+
+
+//*****************************************
+//* when_all()
+//* - starts all senders and completes when all of them completed:
+//*   - with a tuple of all non-void values if all succeeded
+//*   - else with the first error (or set_stopped() if there was no error)
+//* - the first error or stop requests stop for all siblings
+//*   (using an inplace_stop_source in the operation state,
+//*    which also forwards stop requests of the receiver)
+//*****************************************
+template <typename... _Senders>
+struct __when_all_sender {
+  using value_type = decltype(std::tuple_cat(std::declval<
+                                std::conditional_t<std::is_void_v<__value_t<_Senders>>,
+                                                   std::tuple<>,
+                                                   std::tuple<__value_t<_Senders>>>>()...));
+
+  // ordered by priority:
+  enum class __result : int { __values, __stopped, __error };
+
+  // everything of the operation state but the child operation states:
+  template <typename _Receiver>
+  struct __state {
+    explicit __state(_Receiver&& __r)
+     : __rcvr_{std::move(__r)} {
+    }
+
+    void __arrive() noexcept {
+      if (__remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        __complete();
+      }
+    }
+
+    void __fail(__result __kind, std::exception_ptr __e) noexcept {
+      // errors win over stops, the first error wins over later errors:
+      int __old = __result_.load(std::memory_order_relaxed);
+      while (__old < static_cast<int>(__kind)) {
+        if (__result_.compare_exchange_weak(__old, static_cast<int>(__kind), std::memory_order_acq_rel)) {
+          if (__kind == __result::__error) {
+            __error_ = std::move(__e);
+          }
+          __stop_.request_stop();
+          break;
+        }
+      }
+      __arrive();
+    }
+
+    template <typename _S, typename _Opt>
+    static auto __as_tuple(_Opt& __opt) {
+      if constexpr (std::is_void_v<__value_t<_S>>) {
+        return std::tuple<>{};
+      }
+      else {
+        return std::tuple<__value_t<_S>>{std::move(*__opt)};
+      }
+    }
+
+    void __complete() noexcept {
+      __onStop_.reset();
+      switch (static_cast<__result>(__result_.load(std::memory_order_relaxed))) {
+        case __result::__values:
+          try {
+            __rcvr_.set_value(std::apply([] (auto&... __opts) {
+                                           return std::tuple_cat(__as_tuple<_Senders>(__opts)...);
+                                         }, __values_));
+          }
+          catch (...) {
+            __rcvr_.set_error(std::current_exception());
+          }
+          break;
+        case __result::__error:
+          __rcvr_.set_error(std::move(__error_));
+          break;
+        case __result::__stopped:
+          __rcvr_.set_stopped();
+          break;
+      }
+    }
+
+    _Receiver __rcvr_;
+    inplace_stop_source __stop_;
+    std::optional<stop_callback<__forward_stop>> __onStop_;
+    std::atomic<std::size_t> __remaining_{sizeof...(_Senders)};
+    std::atomic<int> __result_{static_cast<int>(__result::__values)};
+    std::exception_ptr __error_;
+    std::tuple<std::optional<__non_void_t<__value_t<_Senders>>>...> __values_;
+  };
+
+  template <typename _Receiver, std::size_t _I>
+  struct __rcvr {
+    __state<_Receiver>* __st_;
+
+    template <typename... _Vs>
+    void set_value(_Vs&&... __vs) noexcept {
+      try {
+        std::get<_I>(__st_->__values_).emplace(std::forward<_Vs>(__vs)...);
+      }
+      catch (...) {
+        __st_->__fail(__result::__error, std::current_exception());
+        return;
+      }
+      __st_->__arrive();
+    }
+    void set_error(std::exception_ptr __e) noexcept {
+      __st_->__fail(__result::__error, std::move(__e));
+    }
+    void set_stopped() noexcept {
+      __st_->__fail(__result::__stopped, nullptr);
+    }
+    stop_token get_stop_token() const noexcept {
+      return __st_->__stop_.get_token();
+    }
+  };
+
+  template <typename _Receiver, typename _Indices>
+  struct __op;
+
+  template <typename _Receiver, std::size_t... _Is>
+  struct __op<_Receiver, std::index_sequence<_Is...>>
+   : __state<_Receiver>,
+     __in_place_from<connect_result_t<_Senders, __rcvr<_Receiver, _Is>>, _Is>... {
+    __op(std::tuple<_Senders...>&& __sndrs, _Receiver&& __r)
+     : __state<_Receiver>{std::move(__r)},
+       __in_place_from<connect_result_t<_Senders, __rcvr<_Receiver, _Is>>, _Is>{[&] {
+         return std::get<_Is>(std::move(__sndrs)).connect(__rcvr<_Receiver, _Is>{this});
+       }}... {
+    }
+    __op(const __op&) = delete;
+    __op& operator=(const __op&) = delete;
+
+    void start() noexcept {
+      this->__onStop_.emplace(this->__rcvr_.get_stop_token(), __forward_stop{&this->__stop_});
+      if constexpr (sizeof...(_Senders) == 0) {
+        this->__complete();
+      }
+      else {
+        // the last start() might complete and destroy *this:
+        (static_cast<__in_place_from<connect_result_t<_Senders, __rcvr<_Receiver, _Is>>, _Is>&>(*this)
+           .__value_.start(), ...);
+      }
+    }
+  };
+
+  template <typename _Receiver>
+  __op<_Receiver, std::index_sequence_for<_Senders...>> connect(_Receiver __r) && {
+    return {std::move(__sndrs_), std::move(__r)};
+  }
+
+  std::tuple<_Senders...> __sndrs_;
+};
+
+template <typename... Senders>
+__when_all_sender<std::decay_t<Senders>...> when_all(Senders&&... sndrs) {
+  return {std::tuple<std::decay_t<Senders>...>{std::forward<Senders>(sndrs)...}};
+}
+
+
+//*****************************************
+//* stop_when()
+//* - runs a sender with a stop_token that is signalled if either the
+//*   receiver gets a stop request or the passed stop_token is signalled
+//*****************************************
+template <typename _Sender>
+struct __stop_when_sender {
+  using value_type = __value_t<_Sender>;
+
+  template <typename _Receiver>
+  struct __op;
+
+  template <typename _Receiver>
+  struct __rcvr {
+    __op<_Receiver>* __op_;
+
+    template <typename... _Vs>
+    void set_value(_Vs&&... __vs) noexcept {
+      __op_->__reset();
+      __op_->__rcvr_.set_value(std::forward<_Vs>(__vs)...);
+    }
+    void set_error(std::exception_ptr __e) noexcept {
+      __op_->__reset();
+      __op_->__rcvr_.set_error(std::move(__e));
+    }
+    void set_stopped() noexcept {
+      __op_->__reset();
+      __op_->__rcvr_.set_stopped();
+    }
+    stop_token get_stop_token() const noexcept {
+      return __op_->__stop_.get_token();
+    }
+  };
+
+  template <typename _Receiver>
+  struct __op {
+    __op(_Sender&& __s, stop_token&& __trigger, _Receiver&& __r)
+     : __rcvr_{std::move(__r)}, __trigger_{std::move(__trigger)},
+       __op_{std::move(__s).connect(__rcvr<_Receiver>{this})} {
+    }
+    __op(const __op&) = delete;
+    __op& operator=(const __op&) = delete;
+
+    void start() noexcept {
+      __onStop_.emplace(__rcvr_.get_stop_token(), __forward_stop{&__stop_});
+      __onTrigger_.emplace(__trigger_, __forward_stop{&__stop_});
+      __op_.start();
+    }
+
+    void __reset() noexcept {
+      __onStop_.reset();
+      __onTrigger_.reset();
+    }
+
+    _Receiver __rcvr_;
+    stop_token __trigger_;
+    inplace_stop_source __stop_;
+    std::optional<stop_callback<__forward_stop>> __onStop_;
+    std::optional<stop_callback<__forward_stop>> __onTrigger_;
+    connect_result_t<_Sender, __rcvr<_Receiver>> __op_;
+  };
+
+  template <typename _Receiver>
+  __op<_Receiver> connect(_Receiver __r) && {
+    return __op<_Receiver>{std::move(__sndr_), std::move(__trigger_), std::move(__r)};
+  }
+
+  _Sender __sndr_;
+  stop_token __trigger_;
+};
+
+template <typename Sender>
+__stop_when_sender<std::decay_t<Sender>> stop_when(Sender&& sndr, stop_token stoken) {
+  return {std::forward<Sender>(sndr), std::move(stoken)};
+}
+
+
+//*****************************************
+//* class run_loop
+//* - executes the work scheduled by its scheduler in the thread calling run()
+//* - the queue is intrusive, i.e. it links the operation states
+//* - scheduled work completes with set_stopped() if stop was requested
+//*   for its receiver meanwhile
+//*****************************************
+class run_loop
+{
+    struct __task {
+      void (*__execute_)(__task*) noexcept;
+      __task* __next_ = nullptr;
+    };
+
+  public:
+    class scheduler
+    {
+      public:
+        template <typename _Receiver>
+        struct __op : __task {
+          __op(run_loop* __loop, _Receiver&& __r)
+           : __task{&__op::__execute}, __loop_{__loop}, __rcvr_{std::move(__r)} {
+          }
+          __op(const __op&) = delete;
+          __op& operator=(const __op&) = delete;
+
+          void start() noexcept {
+            if (!__loop_->_push(this)) {
+              // the loop is finishing, so this work would never be executed:
+              __rcvr_.set_stopped();
+            }
+          }
+          static void __execute(__task* __t) noexcept {
+            auto* __self = static_cast<__op*>(__t);
+            if (__self->__rcvr_.get_stop_token().stop_requested()) {
+              __self->__rcvr_.set_stopped();
+            }
+            else {
+              __self->__rcvr_.set_value();
+            }
+          }
+
+          run_loop* __loop_;
+          _Receiver __rcvr_;
+        };
+
+        struct __sender {
+          using value_type = void;
+          template <typename _Receiver>
+          __op<_Receiver> connect(_Receiver __r) && {
+            return __op<_Receiver>{__loop_, std::move(__r)};
+          }
+          run_loop* __loop_;
+        };
+
+        // sender completing in the thread running the loop:
+        __sender schedule() const noexcept {
+          return __sender{_loop};
+        }
+
+        friend bool operator==(const scheduler& a, const scheduler& b) noexcept {
+          return a._loop == b._loop;
+        }
+        friend bool operator!=(const scheduler& a, const scheduler& b) noexcept {
+          return a._loop != b._loop;
+        }
+
+      private:
+        friend class run_loop;
+        explicit scheduler(run_loop* loop) noexcept
+         : _loop{loop} {
+        }
+        run_loop* _loop;
+    };
+
+    run_loop() = default;
+    run_loop(const run_loop&) = delete;
+    run_loop& operator=(const run_loop&) = delete;
+
+    scheduler get_scheduler() noexcept {
+      return scheduler{this};
+    }
+
+    // execute scheduled work until finish() was called and the queue is empty:
+    void run();
+
+    // work scheduled after finish() completes with set_stopped() immediately:
+    void finish();
+
+  private:
+    bool _push(__task* t);   // false if finishing
+    __task* _pop();   // nullptr if finishing and empty
+
+    std::mutex _mx;
+    std::condition_variable _cv;
+    __task* _head = nullptr;
+    __task* _tail = nullptr;
+    bool _finishing = false;
+};
+
+inline void run_loop::run()
+{
+  while (__task* t = _pop()) {
+    t->__execute_(t);
+  }
+}
+
+inline void run_loop::finish()
+{
+  std::lock_guard<std::mutex> lg{_mx};
+  _finishing = true;
+  _cv.notify_all();
+}
+
+inline bool run_loop::_push(__task* t)
+{
+  std::lock_guard<std::mutex> lg{_mx};
+  if (_finishing) {
+    return false;
+  }
+  t->__next_ = nullptr;
+  if (_tail == nullptr) {
+    _head = t;
+  }
+  else {
+    _tail->__next_ = t;
+  }
+  _tail = t;
+  _cv.notify_one();
+  return true;
+}
+
+inline run_loop::__task* run_loop::_pop()
+{
+  std::unique_lock<std::mutex> lock{_mx};
+  _cv.wait(lock, [this] { return _head != nullptr || _finishing; });
+  __task* t = _head;
+  if (t != nullptr) {
+    _head = t->__next_;
+    if (_head == nullptr) {
+      _tail = nullptr;
+    }
+  }
+  return t;
+}
+
+
+//*****************************************
+//* class jthread_context
+//* - run_loop driven by its own jthread
+//* - request_stop() (and the destructor) finish the loop
+//*   after all work scheduled so far was executed
+//* - work scheduled later completes with set_stopped()
+//*****************************************
+class jthread_context
+{
+  public:
+    jthread_context()
+     : _thread{[this] (stop_token st) {
+                 stop_callback onStop{st, [this] { _loop.finish(); }};
+                 _loop.run();
+               }} {
+    }
+
+    run_loop::scheduler get_scheduler() noexcept {
+      return _loop.get_scheduler();
+    }
+    jthread::id get_id() const noexcept {
+      return _thread.get_id();
+    }
+    bool request_stop() noexcept {
+      return _thread.request_stop();
+    }
+
+  private:
+    run_loop _loop;
+    jthread _thread;    // declared last, so that it is started last and joined first
+};
+
+
+//*****************************************
+//* sync_wait()
+//* - starts a sender with the passed stop_token and blocks until it completes
+//* - returns the value (std::monostate for void) or
+//*   an empty optional if the sender completed with set_stopped()
+//* - rethrows errors
+//*****************************************
+template <typename _T>
+struct __sync_wait_state {
+  std::atomic<std::uint32_t> __done_{0};
+  std::optional<__non_void_t<_T>> __value_;
+  std::exception_ptr __error_;
+  stop_token __stoken_;
+};
+
+template <typename _T>
+struct __sync_wait_receiver {
+  __sync_wait_state<_T>* __st_;
+
+  template <typename... _Vs>
+  void set_value(_Vs&&... __vs) noexcept {
+    try {
+      __st_->__value_.emplace(std::forward<_Vs>(__vs)...);
+    }
+    catch (...) {
+      __st_->__error_ = std::current_exception();
+    }
+    __signal();
+  }
+  void set_error(std::exception_ptr __e) noexcept {
+    __st_->__error_ = std::move(__e);
+    __signal();
+  }
+  void set_stopped() noexcept {
+    __signal();
+  }
+  stop_token get_stop_token() const noexcept {
+    return __st_->__stoken_;
+  }
+
+  void __signal() noexcept {
+    // after the store the state might be gone immediately:
+    std::atomic<std::uint32_t>* __done = &__st_->__done_;
+    __done->store(1, std::memory_order_release);
+    __futex_wake_all(__done);
+  }
+};
+
+template <typename Sender>
+std::optional<__non_void_t<__value_t<Sender>>> sync_wait(Sender sndr, stop_token stoken = {})
+{
+  using T = __value_t<Sender>;
+  __sync_wait_state<T> st;
+  st.__stoken_ = std::move(stoken);
+  auto op = std::move(sndr).connect(__sync_wait_receiver<T>{&st});
+  op.start();
+  while (st.__done_.load(std::memory_order_acquire) == 0) {
+    __futex_wait(&st.__done_, 0);
+  }
+  if (st.__error_) {
+    std::rethrow_exception(st.__error_);
+  }
+  return std::move(st.__value_);
+}
+
+
+} // execution
+} // std
+
+#endif // EXECUTION_HPP
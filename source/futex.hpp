@@ -0,0 +1,192 @@
+#pragma once
+// internal helper: block on a 32-bit atomic until it is woken up (futex semantics)
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#endif
+
+namespace std {
+
+//-----------------------------------------------
+// - __futex_wait*() block only if *__addr still has the value __expected
+// - spurious wakeups are possible, so callers have to re-check their condition
+// - __futex_wake*() wake up threads blocked on __addr
+//   (it is fine to call them with the address of an object that was destroyed
+//    meanwhile, because the address is only used as a key)
+//-----------------------------------------------
+
+#if defined(__linux__)
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex requires atomic<uint32_t> to have the size of uint32_t");
+
+inline int __futex_call(const std::atomic<std::uint32_t>* __addr, int __op, std::uint32_t __val,
+                        const struct timespec* __timeout = nullptr, std::uint32_t __val3 = 0) noexcept {
+  return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(__addr),
+                                    __op, __val, __timeout, nullptr, __val3));
+}
+
+inline void __futex_wait(const std::atomic<std::uint32_t>* __addr, std::uint32_t __expected) noexcept {
+  __futex_call(__addr, FUTEX_WAIT_PRIVATE, __expected);
+}
+
+// returns false on timeout:
+inline bool __futex_wait_until_steady(const std::atomic<std::uint32_t>* __addr, std::uint32_t __expected,
+                                      std::chrono::steady_clock::time_point __abs_time) noexcept {
+  // no system call if the timeout has already expired:
+  if (__abs_time <= std::chrono::steady_clock::now()) {
+    return false;
+  }
+  // steady_clock is CLOCK_MONOTONIC, which FUTEX_WAIT_BITSET uses for absolute timeouts:
+  auto __ns = std::chrono::duration_cast<std::chrono::nanoseconds>(__abs_time.time_since_epoch()).count();
+  if (__ns < 0) {
+    __ns = 0;
+  }
+  struct timespec __ts;
+  __ts.tv_sec = static_cast<time_t>(__ns / 1000000000);
+  __ts.tv_nsec = static_cast<long>(__ns % 1000000000);
+  if (__futex_call(__addr, FUTEX_WAIT_BITSET_PRIVATE, __expected, &__ts, FUTEX_BITSET_MATCH_ANY) == -1
+      && errno == ETIMEDOUT) {
+    return false;
+  }
+  return true;
+}
+
+inline void __futex_wake(const std::atomic<std::uint32_t>* __addr, int __count) noexcept {
+  __futex_call(__addr, FUTEX_WAKE_PRIVATE, static_cast<std::uint32_t>(__count));
+}
+
+#else
+
+// portable fallback: hashed table of mutexes/condition variables
+struct __futex_bucket {
+  std::mutex __mx;
+  std::condition_variable __cv;
+};
+
+inline __futex_bucket& __futex_bucket_for(const void* __addr) noexcept {
+  static __futex_bucket __buckets[64];
+  return __buckets[(std::hash<const void*>{}(__addr) >> 4) % 64];
+}
+
+inline void __futex_wait(const std::atomic<std::uint32_t>* __addr, std::uint32_t __expected) noexcept {
+  auto& __b = __futex_bucket_for(__addr);
+  std::unique_lock<std::mutex> __lock{__b.__mx};
+  if (__addr->load(std::memory_order_relaxed) == __expected) {
+    __b.__cv.wait(__lock);
+  }
+}
+
+inline bool __futex_wait_until_steady(const std::atomic<std::uint32_t>* __addr, std::uint32_t __expected,
+                                      std::chrono::steady_clock::time_point __abs_time) noexcept {
+  auto& __b = __futex_bucket_for(__addr);
+  std::unique_lock<std::mutex> __lock{__b.__mx};
+  if (__addr->load(std::memory_order_relaxed) == __expected) {
+    return __b.__cv.wait_until(__lock, __abs_time) == std::cv_status::no_timeout;
+  }
+  return true;
+}
+
+inline void __futex_wake(const std::atomic<std::uint32_t>* __addr, int /*__count*/) noexcept {
+  // buckets are shared by different addresses, so always wake all:
+  auto& __b = __futex_bucket_for(__addr);
+  std::lock_guard<std::mutex> __lock{__b.__mx};
+  __b.__cv.notify_all();
+}
+
+#endif
+
+// wait with an arbitrary clock
+// - returns false on timeout:
+template <typename _Clock, typename _Duration>
+inline bool __futex_wait_until(const std::atomic<std::uint32_t>* __addr, std::uint32_t __expected,
+                               const std::chrono::time_point<_Clock, _Duration>& __abs_time) noexcept {
+  if constexpr (std::is_same_v<_Clock, std::chrono::steady_clock>) {
+    return __futex_wait_until_steady(__addr, __expected,
+             std::chrono::time_point_cast<std::chrono::steady_clock::duration>(__abs_time));
+  }
+  else {
+    const auto __now = _Clock::now();
+    if (__now >= __abs_time) {
+      return false;
+    }
+    __futex_wait_until_steady(__addr, __expected,
+      std::chrono::steady_clock::now()
+       + std::chrono::ceil<std::chrono::steady_clock::duration>(__abs_time - __now));
+    return _Clock::now() < __abs_time;
+  }
+}
+
+inline void __futex_wake_one(const std::atomic<std::uint32_t>* __addr) noexcept {
+  __futex_wake(__addr, 1);
+}
+
+inline void __futex_wake_all(const std::atomic<std::uint32_t>* __addr) noexcept {
+  __futex_wake(__addr, INT_MAX);
+}
+
+//-----------------------------------------------
+// count of the waiters using the internals of a condition variable,
+// so that its destructor can wait until notified waiters no longer use them:
+// - __waiter_guard counts a waiter while it uses the internals
+// - __release_waiters() uncounts waiters (e.g. released by a notifier)
+// - __drain_waiters() (called by the destructor) sets the destroying flag
+//   and blocks until the count drops to zero
+//-----------------------------------------------
+
+inline constexpr std::uint32_t __waiters_destroying = 0x80000000u;
+
+// after the decrement the owner of __waiters might be destroyed immediately:
+inline void __release_waiters(std::atomic<std::uint32_t>& __waiters, std::uint32_t __n) noexcept {
+  std::atomic<std::uint32_t>* __w = &__waiters;
+  if (__w->fetch_sub(__n, std::memory_order_release) == (__waiters_destroying | __n)) {
+    __futex_wake_all(__w);
+  }
+}
+
+inline void __drain_waiters(std::atomic<std::uint32_t>& __waiters) noexcept {
+  std::uint32_t __n = __waiters.fetch_or(__waiters_destroying, std::memory_order_acquire);
+  while (__n != 0 && __n != __waiters_destroying) {
+    __futex_wait(&__waiters, __n | __waiters_destroying);
+    __n = __waiters.load(std::memory_order_acquire);
+  }
+}
+
+class __waiter_guard {
+  public:
+    explicit __waiter_guard(std::atomic<std::uint32_t>& __waiters) noexcept
+     : __waiters_(__waiters) {
+      __waiters_.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~__waiter_guard() {
+      if (__counted_) {
+        __release_waiters(__waiters_, 1);
+      }
+    }
+    __waiter_guard(const __waiter_guard&) = delete;
+    __waiter_guard& operator=(const __waiter_guard&) = delete;
+
+    // the waiter was released by somebody else:
+    void __dismiss() noexcept {
+      __counted_ = false;
+    }
+
+  private:
+    std::atomic<std::uint32_t>& __waiters_;
+    bool __counted_ = true;
+};
+
+} // namespace std
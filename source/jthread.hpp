@@ -5,14 +5,177 @@
 #define JTHREAD_HPP
 
 #include "stop_token.hpp"
+#include "futex.hpp"
 #include <thread>
 #include <future>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <system_error>
 #include <type_traits>
 #include <functional>  // for invoke()
 #include <iostream>    // for debugging output
 
 namespace std {
 
+//***************************************** 
+//* class __jthread_stop_state
+//* - stop state of a jthread, which also signals the end of its callable
+//*   (for timed joins) and holds its exception (for propagate_exceptions)
+//* - the derived states of spawn() also hold the result,
+//*   so each jthread needs only one allocation besides the thread itself
+//***************************************** 
+struct __jthread_stop_state : __stop_state {
+  // becomes 1 when the callable of the started thread has returned:
+  std::atomic<std::uint32_t> __finished_{0};
+  // exception of the callable (only captured for propagate_exceptions and spawn()):
+  std::exception_ptr __exception_;
+
+  __jthread_stop_state() noexcept
+   : __stop_state{&__jthread_stop_state::__delete<__jthread_stop_state>} {
+  }
+
+  // signals the end of the callable (however it ends):
+  // - holds a stop_token, so that the state lives until it is signalled
+  struct __finish_guard {
+    stop_token __token_;
+    __jthread_stop_state* __state() const noexcept {
+      return static_cast<__jthread_stop_state*>(__token_.__state_);
+    }
+    ~__finish_guard() {
+      // (never null, but checked to not confuse the compiler's overflow analysis)
+      if (auto* __state = this->__state()) {
+        __state->__finished_.store(1, std::memory_order_release);
+        __futex_wake_all(&__state->__finished_);
+      }
+    }
+  };
+
+  // returns false on timeout:
+  template <typename _Clock, typename _Duration>
+  bool __wait_until_finished(const chrono::time_point<_Clock, _Duration>& __abs_time) noexcept {
+    while (__finished_.load(std::memory_order_acquire) == 0) {
+      if (!__futex_wait_until(&__finished_, 0, __abs_time)) {
+        return __finished_.load(std::memory_order_acquire) != 0;
+      }
+    }
+    return true;
+  }
+
+  // run the callable in the started thread (an exception calls terminate()):
+  template <typename _Callable, typename... _Args>
+  static void __run(__jthread_stop_state*, _Callable&& __cb, _Args&&... __args) {
+    ::std::invoke(::std::forward<_Callable>(__cb), ::std::forward<_Args>(__args)...);
+  }
+
+ protected:
+  // for derived states, which are deleted as such:
+  explicit __jthread_stop_state(void (*__deleter)(__stop_state*) noexcept) noexcept
+   : __stop_state{__deleter} {
+  }
+  template <typename _State>
+  static void __delete(__stop_state* __state) noexcept {
+    delete static_cast<_State*>(__state);
+  }
+};
+
+//***************************************** 
+//* class __jthread_capturing_state
+//* - stop state that captures the exception of the callable
+//*   instead of calling terminate()
+//***************************************** 
+struct __jthread_capturing_state : __jthread_stop_state {
+  __jthread_capturing_state() noexcept
+   : __jthread_stop_state{&__jthread_stop_state::__delete<__jthread_capturing_state>} {
+  }
+
+  // hides __jthread_stop_state::__run():
+  template <typename _Callable, typename... _Args>
+  static void __run(__jthread_capturing_state* __state, _Callable&& __cb, _Args&&... __args) noexcept {
+    try {
+      ::std::invoke(::std::forward<_Callable>(__cb), ::std::forward<_Args>(__args)...);
+    }
+    catch (...) {
+      __state->__exception_ = std::current_exception();
+    }
+  }
+
+ protected:
+  explicit __jthread_capturing_state(void (*__deleter)(__stop_state*) noexcept) noexcept
+   : __jthread_stop_state{__deleter} {
+  }
+};
+
+//***************************************** 
+//* class __jthread_result_state
+//* - stop state that also holds the result (or exception) of the callable
+//*   (no separate shared state as for std::future)
+//***************************************** 
+template <typename _Result>
+struct __jthread_result_state : __jthread_stop_state {
+  using __value_type = std::conditional_t<std::is_reference_v<_Result>,
+                                          std::reference_wrapper<std::remove_reference_t<_Result>>,
+                                          _Result>;
+  std::optional<__value_type> __value_;
+
+  __jthread_result_state() noexcept
+   : __jthread_stop_state{&__jthread_stop_state::__delete<__jthread_result_state>} {
+  }
+
+  // hides __jthread_stop_state::__run():
+  template <typename _Callable, typename... _Args>
+  static void __run(__jthread_result_state* __state, _Callable&& __cb, _Args&&... __args) noexcept {
+    try {
+      __state->__value_.emplace(::std::invoke(::std::forward<_Callable>(__cb), ::std::forward<_Args>(__args)...));
+    }
+    catch (...) {
+      __state->__exception_ = std::current_exception();
+    }
+  }
+
+  // hand over the result after the started thread finished without exception:
+  _Result __get() {
+    if constexpr (std::is_reference_v<_Result>) {
+      return __value_->get();
+    }
+    else {
+      return std::move(*__value_);
+    }
+  }
+};
+
+template <>
+struct __jthread_result_state<void> : __jthread_capturing_state {
+  __jthread_result_state() noexcept
+   : __jthread_capturing_state{&__jthread_stop_state::__delete<__jthread_result_state>} {
+  }
+  void __get() noexcept {
+  }
+};
+
+// result of a callable started by a jthread (with or without stop_token):
+template <typename _Callable, typename... _Args>
+using __jthread_result_t = typename std::conditional_t<
+                             std::is_invocable_v<std::decay_t<_Callable>, stop_token, std::decay_t<_Args>...>,
+                             std::invoke_result<std::decay_t<_Callable>, stop_token, std::decay_t<_Args>...>,
+                             std::invoke_result<std::decay_t<_Callable>, std::decay_t<_Args>...>>::type;
+
+template <typename R>
+class jthread_handle;
+
+// std::propagate_exceptions
+// - to start a jthread whose join() rethrows the exception of the callable
+struct propagate_exceptions_t { explicit propagate_exceptions_t() = default; };
+inline constexpr propagate_exceptions_t propagate_exceptions{};
+
+
+// stop_token of the jthread running on the current thread (if any):
+// - set once by the started thread, so that this_thread::get_stop_token()
+//   doesn't have to touch any reference count
+inline thread_local stop_token __this_thread_stop_token;
+
+
 //***************************************** 
 //* class jthread
 //* - joining std::thread with signaling stop/end support 
@@ -36,7 +199,8 @@ class jthread
     // THE constructor that starts the thread:
     // - NOTE: does SFINAE out copy constructor semantics
     template <typename Callable, typename... Args,
-              typename = ::std::enable_if_t<!::std::is_same_v<::std::decay_t<Callable>, jthread>>>
+              typename = ::std::enable_if_t<!::std::is_same_v<::std::decay_t<Callable>, jthread> &&
+                                            !::std::is_same_v<::std::decay_t<Callable>, propagate_exceptions_t>>>
     explicit jthread(Callable&& cb, Args&&... args);
     ~jthread();
 
@@ -68,15 +232,64 @@ class jthread
       return get_stop_source().request_stop();
     }
 
+    //   - timed join:
+    //     - return false if the thread did not finish in time (then it is still joinable)
+    template <typename Rep, typename Period>
+    bool try_join_for(const chrono::duration<Rep, Period>& rel_time) {
+      return try_join_until(chrono::steady_clock::now() + rel_time);
+    }
+    template <typename Clock, typename Duration>
+    bool try_join_until(const chrono::time_point<Clock, Duration>& abs_time);
+
+    //   - deadline for the join in the destructor and the move assignment:
+    //     - if the started thread does not finish in time, it gets detached
+    //     - by default there is no deadline
+    template <typename Rep, typename Period>
+    void set_join_timeout(const chrono::duration<Rep, Period>& rel_time) noexcept {
+      _joinTimeout = chrono::ceil<chrono::steady_clock::duration>(rel_time);
+    }
+    [[nodiscard]] chrono::steady_clock::duration get_join_timeout() const noexcept {
+      return _joinTimeout;
+    }
+
+    //   - start a thread whose exception is rethrown by join() and try_join_*()
+    //     (instead of calling terminate(); the destructor discards the exception):
+    template <typename Callable, typename... Args>
+    explicit jthread(propagate_exceptions_t, Callable&& cb, Args&&... args);
+
+    //   - start a thread whose result (or exception) is handed over by join():
+    template <typename Callable, typename... Args>
+    [[nodiscard]] static jthread_handle<__jthread_result_t<Callable, Args...>>
+    spawn(Callable&& cb, Args&&... args);
+
 
   //***************************************** 
   //* implementation:
   //***************************************** 
 
   private:
+    template <typename R>
+    friend class jthread_handle;
+
+    // start the thread with a given type of stop state:
+    template <typename State>
+    struct launch_tag {};
+    template <typename State, typename Callable, typename... Args>
+    jthread(launch_tag<State>, Callable&& cb, Args&&... args);
+
+    void stopAndJoin();
+
+    // stop state signalling the end of the callable (for timed joins)
+    // and holding its exception or result:
+    __jthread_stop_state* finishedState() const noexcept {
+      return static_cast<__jthread_stop_state*>(_stopSource.__state_);
+    }
+
     //*** API for the starting thread:
-    stop_source _stopSource;                   // stop_source for started thread
+    stop_source _stopSource;                   // stop_source for started thread (a __jthread_stop_state)
     ::std::thread _thread{};                   // started thread (if any)
+    // (a property of this object, which also applies to threads move-assigned later):
+    chrono::steady_clock::duration _joinTimeout = chrono::steady_clock::duration::max();
 };
 
 
@@ -96,19 +309,46 @@ inline jthread::jthread() noexcept
 template <typename Callable, typename... Args,
           typename >
 inline jthread::jthread(Callable&& cb, Args&&... args)
- : _stopSource{},                             // initialize stop_source
+ : jthread{launch_tag<__jthread_stop_state>{},
+           ::std::forward<Callable>(cb),
+           ::std::forward<Args>(args)...}
+{
+}
+
+// constructor for threads propagating exceptions to join():
+template <typename Callable, typename... Args>
+inline jthread::jthread(propagate_exceptions_t, Callable&& cb, Args&&... args)
+ : jthread{launch_tag<__jthread_capturing_state>{},
+           ::std::forward<Callable>(cb),
+           ::std::forward<Args>(args)...}
+{
+}
+
+// start the thread with a given type of stop state:
+// - State::__run() runs the callable (and might store its exception or result)
+template <typename State, typename Callable, typename... Args>
+inline jthread::jthread(launch_tag<State>, Callable&& cb, Args&&... args)
+ : _stopSource{new State{}},   // initialize stop_source
    _thread{[] (stop_token st, auto&& cb, auto&&... args) {   // called lambda in the thread
+                 // signal timed joins when done:
+                 __jthread_stop_state::__finish_guard finished{st};
+                 State* state = static_cast<State*>(finished.__state());
                  // perform tasks of the thread:
                  if constexpr(std::is_invocable_v<Callable, stop_token, Args...>) {
+                   // publish the stop_token for this_thread::get_stop_token():
+                   __this_thread_stop_token = st;
                    // pass the stop_token as first argument to the started thread:
-                   ::std::invoke(::std::forward<decltype(cb)>(cb),
-                                 std::move(st),
-                                 ::std::forward<decltype(args)>(args)...);
+                   State::__run(state,
+                                ::std::forward<decltype(cb)>(cb),
+                                std::move(st),
+                                ::std::forward<decltype(args)>(args)...);
                  }
                  else {
                    // started thread does not expect a stop token:
-                   ::std::invoke(::std::forward<decltype(cb)>(cb),
-                                 ::std::forward<decltype(args)>(args)...);
+                   __this_thread_stop_token = ::std::move(st);
+                   State::__run(state,
+                                ::std::forward<decltype(cb)>(cb),
+                                ::std::forward<decltype(args)>(args)...);
                  }
                },
                _stopSource.get_token(),   // not captured due to possible races if immediately set
@@ -121,20 +361,32 @@ inline jthread::jthread(Callable&& cb, Args&&... args)
 // move assignment operator:
 inline jthread& jthread::operator=(jthread&& t) noexcept {
   if (joinable()) {   // if not joined/detached, signal stop and wait for end:
-    request_stop();
-    join();
+    stopAndJoin();
   }
 
   _thread = std::move(t._thread);
   _stopSource = std::move(t._stopSource);
+  _joinTimeout = t._joinTimeout;
   return *this;
 }
 
 // destructor:
 inline jthread::~jthread() {
   if (joinable()) {   // if not joined/detached, signal stop and wait for end:
-    request_stop();
-    join();
+    stopAndJoin();
+  }
+}
+
+// signal stop and wait for end (with the deadline from set_join_timeout(), if any):
+// - a captured exception is discarded
+inline void jthread::stopAndJoin() {
+  request_stop();
+  if (_joinTimeout == chrono::steady_clock::duration::max()
+      || finishedState()->__wait_until_finished(chrono::steady_clock::now() + _joinTimeout)) {
+    _thread.join();
+  }
+  else {
+    _thread.detach();
   }
 }
 
@@ -145,10 +397,27 @@ inline bool jthread::joinable() const noexcept {
 }
 inline void jthread::join() {
   _thread.join();
+  // rethrow exception captured in propagate_exceptions mode:
+  if (auto* state = finishedState(); state != nullptr && state->__exception_ != nullptr) {
+    ::std::rethrow_exception(::std::exchange(state->__exception_, nullptr));
+  }
 }
 inline void jthread::detach() {
   _thread.detach();
 }
+
+template <typename Clock, typename Duration>
+inline bool jthread::try_join_until(const chrono::time_point<Clock, Duration>& abs_time) {
+  if (!joinable()) {
+    throw ::std::system_error{::std::make_error_code(::std::errc::invalid_argument)};
+  }
+  // wait for the callable to return (the thread itself might need a bit longer to end):
+  if (!finishedState()->__wait_until_finished(abs_time)) {
+    return false;
+  }
+  join();
+  return true;
+}
 inline typename jthread::id jthread::get_id() const noexcept {
   return _thread.get_id();
 }
@@ -166,9 +435,153 @@ inline stop_token jthread::get_stop_token() const noexcept {
 inline void jthread::swap(jthread& t) noexcept {
     std::swap(_stopSource, t._stopSource);
     std::swap(_thread, t._thread);
+    std::swap(_joinTimeout, t._joinTimeout);
 }
 
 
+//***************************************** 
+//* class jthread_handle
+//* - jthread started by jthread::spawn()
+//* - join() returns the result of the callable or rethrows its exception
+//* - the result is stored in the stop state the thread shares with the handle anyway,
+//*   so there is no extra allocation and locking as for std::packaged_task
+//***************************************** 
+template <typename R>
+class jthread_handle
+{
+  public:
+    using id = jthread::id;
+    using result_type = R;
+
+    jthread_handle() noexcept = default;
+    // destructor signals stop and joins (discarding the result)
+
+    bool joinable() const noexcept {
+      return _thread.joinable();
+    }
+    // wait for the end of the thread and hand over the result:
+    // - rethrows the exception of the callable (if any)
+    R join() {
+      _thread.join();
+      return static_cast<__jthread_result_state<R>*>(_thread.finishedState())->__get();
+    }
+    void detach() {
+      _thread.detach();
+    }
+
+    // wait until the result is available (without joining):
+    // - return false on timeout
+    template <typename Rep, typename Period>
+    bool wait_for(const chrono::duration<Rep, Period>& rel_time) const {
+      return wait_until(chrono::steady_clock::now() + rel_time);
+    }
+    template <typename Clock, typename Duration>
+    bool wait_until(const chrono::time_point<Clock, Duration>& abs_time) const {
+      if (!joinable()) {
+        throw ::std::system_error{::std::make_error_code(::std::errc::invalid_argument)};
+      }
+      return _thread.finishedState()->__wait_until_finished(abs_time);
+    }
+
+    id get_id() const noexcept {
+      return _thread.get_id();
+    }
+    [[nodiscard]] stop_source get_stop_source() noexcept {
+      return _thread.get_stop_source();
+    }
+    [[nodiscard]] stop_token get_stop_token() const noexcept {
+      return _thread.get_stop_token();
+    }
+    bool request_stop() noexcept {
+      return _thread.request_stop();
+    }
+
+  private:
+    friend class jthread;
+    explicit jthread_handle(jthread&& t) noexcept
+     : _thread{std::move(t)} {
+    }
+
+    jthread _thread;
+};
+
+template <typename Callable, typename... Args>
+inline jthread_handle<__jthread_result_t<Callable, Args...>>
+jthread::spawn(Callable&& cb, Args&&... args)
+{
+  using R = __jthread_result_t<Callable, Args...>;
+  return jthread_handle<R>{jthread{launch_tag<__jthread_result_state<R>>{},
+                                   ::std::forward<Callable>(cb),
+                                   ::std::forward<Args>(args)...}};
+}
+
+
+//***************************************** 
+//* stop_token of the calling thread
+//* - for code called (directly or indirectly) by a jthread
+//*   that doesn't get the stop_token passed
+//* - returns an empty stop_token for threads not started by a jthread
+//***************************************** 
+namespace this_thread {
+
+[[nodiscard]] inline const stop_token& get_stop_token() noexcept {
+  return __this_thread_stop_token;
+}
+
+[[nodiscard]] inline bool stop_requested() noexcept {
+  return __this_thread_stop_token.stop_requested();
+}
+
+} // this_thread
+
+
+//***************************************** 
+//* interruptible sleep
+//* - returns early if stop is requested for the passed stop_token
+//* - return value:
+//*   - true if the full time elapsed
+//*   - false if stop was requested
+//***************************************** 
+namespace this_thread {
+
+template <typename Clock, typename Duration>
+inline bool sleep_until(const chrono::time_point<Clock, Duration>& abs_time,
+                        const stop_token& stoken)
+{
+  if (!stoken.stop_possible()) {
+    ::std::this_thread::sleep_until(abs_time);
+    return true;
+  }
+  // block on a futex word that a stop callback sets
+  // (no mutex and condition variable involved):
+  ::std::atomic<::std::uint32_t> stopped{0};
+  stop_callback cb(stoken, [&stopped] {
+                             stopped.store(1, ::std::memory_order_release);
+                             __futex_wake_all(&stopped);
+                           });
+  while (stopped.load(::std::memory_order_acquire) == 0) {
+    if (!__futex_wait_until(&stopped, 0, abs_time)) {
+      break;   // timeout
+    }
+  }
+  return !stoken.stop_requested();
+}
+
+template <typename Rep, typename Period>
+inline bool sleep_for(const chrono::duration<Rep, Period>& rel_time,
+                      const stop_token& stoken)
+{
+  if (rel_time <= rel_time.zero()) {
+    return !stoken.stop_requested();
+  }
+  return sleep_until(chrono::steady_clock::now()
+                      + chrono::ceil<chrono::steady_clock::duration>(rel_time),
+                     stoken);
+}
+
+} // this_thread
+
+
 } // std
 
 #endif // JTHREAD_HPP
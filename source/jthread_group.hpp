@@ -0,0 +1,151 @@
+// -----------------------------------------------------
+// group of jthreads with parallel stop and join:
+// -----------------------------------------------------
+#ifndef JTHREAD_GROUP_HPP
+#define JTHREAD_GROUP_HPP
+
+#include "jthread.hpp"
+#include <chrono>
+#include <exception>
+#include <vector>
+
+namespace std {
+
+//*****************************************
+//* class jthread_group
+//* - owns a set of jthreads
+//* - on destruction first signals stop to ALL threads and then joins them,
+//*   so that the shutdown latency is the maximum instead of the sum of
+//*   the reaction times of the threads
+//* - supports joining with a deadline, reporting the threads that did
+//*   not finish in time (stragglers)
+//* - the destructor never throws: exceptions of threads started with
+//*   propagate_exceptions are discarded (as by ~jthread()),
+//*   call join() before to get them
+//*****************************************
+class jthread_group
+{
+  public:
+    jthread_group() = default;
+    ~jthread_group();
+
+    jthread_group(const jthread_group&) = delete;
+    jthread_group& operator=(const jthread_group&) = delete;
+
+    // start a new thread in the group:
+    // - the callable might take a stop_token as first argument (as for jthread)
+    template <typename Callable, typename... Args>
+    jthread& emplace_back(Callable&& cb, Args&&... args);
+
+    [[nodiscard]] std::size_t size() const noexcept {
+      return _threads.size();
+    }
+    [[nodiscard]] bool empty() const noexcept {
+      return _threads.empty();
+    }
+    jthread& operator[](std::size_t idx) noexcept {
+      return _threads[idx];
+    }
+
+    // signal stop to all threads (without waiting for them):
+    void request_stop() noexcept;
+
+    // join all threads:
+    // - rethrows the first exception of a thread started with propagate_exceptions
+    //   (the other threads are still joined on destruction)
+    void join();
+
+    // join all threads that finish before abs_time:
+    // - returns the ids of all threads still running (which are still joinable)
+    // - rethrows the first exception of a thread started with propagate_exceptions
+    //   after all threads were handled (then the threads still running
+    //   are those still joinable)
+    template <typename Clock, typename Duration>
+    std::vector<jthread::id> join_until(const chrono::time_point<Clock, Duration>& abs_time);
+
+    template <typename Rep, typename Period>
+    std::vector<jthread::id> join_for(const chrono::duration<Rep, Period>& rel_time) {
+      return join_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+  private:
+    std::vector<jthread> _threads;
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class jthread_group
+//*****************************************
+
+inline jthread_group::~jthread_group()
+{
+  request_stop();
+  // join() would rethrow exceptions of propagate_exceptions threads,
+  // which would call terminate() here:
+  for (auto& t : _threads) {
+    if (t.joinable()) {
+      try {
+        t.join();
+      }
+      catch (...) {
+        // discarded
+      }
+    }
+  }
+}
+
+template <typename Callable, typename... Args>
+inline jthread& jthread_group::emplace_back(Callable&& cb, Args&&... args)
+{
+  return _threads.emplace_back(::std::forward<Callable>(cb), ::std::forward<Args>(args)...);
+}
+
+inline void jthread_group::request_stop() noexcept
+{
+  for (auto& t : _threads) {
+    t.request_stop();
+  }
+}
+
+inline void jthread_group::join()
+{
+  for (auto& t : _threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+template <typename Clock, typename Duration>
+inline std::vector<jthread::id>
+jthread_group::join_until(const chrono::time_point<Clock, Duration>& abs_time)
+{
+  // all threads share the same deadline, so once it is reached,
+  // the remaining threads are only checked without blocking:
+  std::vector<jthread::id> stragglers;
+  std::exception_ptr firstException;
+  for (auto& t : _threads) {
+    try {
+      if (t.joinable() && !t.try_join_until(abs_time)) {
+        stragglers.push_back(t.get_id());
+      }
+    }
+    catch (...) {
+      // the thread is joined, so it is no straggler:
+      if (!firstException) {
+        firstException = std::current_exception();
+      }
+    }
+  }
+  if (firstException) {
+    std::rethrow_exception(firstException);
+  }
+  return stragglers;
+}
+
+
+} // std
+
+#endif // JTHREAD_GROUP_HPP
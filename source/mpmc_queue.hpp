@@ -0,0 +1,261 @@
+// -----------------------------------------------------
+// lock-free bounded MPMC queue with stop_token support:
+// -----------------------------------------------------
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace std {
+
+//*****************************************
+//* class mpmc_queue<T>
+//* - bounded FIFO ring buffer for multiple producers and consumers
+//*   (Dmitry Vyukov's algorithm: each cell has a sequence number telling
+//*    whether it is ready for the next push or pop of its round)
+//* - try_push()/try_pop() are lock-free and never block
+//* - push()/pop() only park (on a futex) if the queue is full/empty and
+//*   return immediately if stop is requested for the passed stop_token
+//* - waking parked threads is only done if there are any,
+//*   so without blocked threads push and pop need no system call
+//* - the capacity is rounded up to a power of two
+//*****************************************
+template <typename T>
+class mpmc_queue
+{
+    static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>,
+                  "mpmc_queue<T> requires T to be nothrow move constructible and destructible");
+
+  public:
+    explicit mpmc_queue(std::size_t capacity);
+    ~mpmc_queue();
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    // non-blocking:
+    // - try_push() returns false if the queue is full (value is not moved then)
+    // - try_pop() returns no value if the queue is empty
+    bool try_push(T&& value) noexcept;
+    bool try_push(const T& value) {
+      T copy{value};
+      return try_push(std::move(copy));
+    }
+    std::optional<T> try_pop() noexcept;
+
+    // blocking:
+    // - push() returns false if stopped before there was space
+    // - pop() returns no value if stopped before an element was available
+    bool push(T value, stop_token stoken = {});
+    std::optional<T> pop(stop_token stoken = {});
+
+    [[nodiscard]] std::size_t capacity() const noexcept {
+      return _mask + 1;
+    }
+    // approximate number of elements:
+    [[nodiscard]] std::size_t size_approx() const noexcept;
+
+  private:
+    struct __cell {
+      std::atomic<std::size_t> __seq;
+      alignas(T) unsigned char __storage[sizeof(T)];
+      T* __ptr() noexcept {
+        return std::launder(reinterpret_cast<T*>(__storage));
+      }
+    };
+
+    // park until __epoch changes, there might be space/elements again, or stop is requested:
+    template <typename _Ready>
+    void __park(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __waiters,
+                const stop_token& __stoken, _Ready __ready);
+    static void __wake(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __waiters) noexcept;
+
+    const std::size_t _mask;
+    std::unique_ptr<__cell[]> _cells;
+    alignas(64) std::atomic<std::size_t> _pushPos{0};
+    alignas(64) std::atomic<std::size_t> _popPos{0};
+    // parking of consumers (queue empty) and producers (queue full):
+    alignas(64) std::atomic<std::uint32_t> _pushEpoch{0};   // changes after pushes with parked consumers
+    std::atomic<std::uint32_t> _popWaiters{0};
+    alignas(64) std::atomic<std::uint32_t> _popEpoch{0};    // changes after pops with parked producers
+    std::atomic<std::uint32_t> _pushWaiters{0};
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class mpmc_queue<T>
+//*****************************************
+
+inline std::size_t __round_up_pow2(std::size_t __n) noexcept
+{
+  std::size_t __p = 1;
+  while (__p < __n) {
+    __p <<= 1;
+  }
+  return __p;
+}
+
+template <typename T>
+inline mpmc_queue<T>::mpmc_queue(std::size_t capacity)
+ : _mask{__round_up_pow2(capacity > 1 ? capacity : 2) - 1}, _cells{new __cell[_mask + 1]}
+{
+  for (std::size_t i = 0; i <= _mask; ++i) {
+    _cells[i].__seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+inline mpmc_queue<T>::~mpmc_queue()
+{
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    while (try_pop()) {
+    }
+  }
+}
+
+template <typename T>
+inline bool mpmc_queue<T>::try_push(T&& value) noexcept
+{
+  __cell* c;
+  std::size_t pos = _pushPos.load(std::memory_order_relaxed);
+  for (;;) {
+    c = &_cells[pos & _mask];
+    const std::size_t seq = c->__seq.load(std::memory_order_acquire);
+    const auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+    if (dif == 0) {
+      if (_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (dif < 0) {
+      return false;    // full (the cell still holds the element of the previous round)
+    }
+    else {
+      pos = _pushPos.load(std::memory_order_relaxed);
+    }
+  }
+  ::new (static_cast<void*>(c->__storage)) T(std::move(value));
+  c->__seq.store(pos + 1, std::memory_order_release);
+  __wake(_pushEpoch, _popWaiters);
+  return true;
+}
+
+template <typename T>
+inline std::optional<T> mpmc_queue<T>::try_pop() noexcept
+{
+  __cell* c;
+  std::size_t pos = _popPos.load(std::memory_order_relaxed);
+  for (;;) {
+    c = &_cells[pos & _mask];
+    const std::size_t seq = c->__seq.load(std::memory_order_acquire);
+    const auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+    if (dif == 0) {
+      if (_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (dif < 0) {
+      return std::nullopt;    // empty (or the push into the cell is not finished yet)
+    }
+    else {
+      pos = _popPos.load(std::memory_order_relaxed);
+    }
+  }
+  std::optional<T> value{std::move(*c->__ptr())};
+  c->__ptr()->~T();
+  c->__seq.store(pos + _mask + 1, std::memory_order_release);
+  __wake(_popEpoch, _pushWaiters);
+  return value;
+}
+
+// NOTE: lost wakeups are avoided by the Dekker-like ordering (all seq_cst):
+//       - the parking thread registers in __waiters, reads __epoch, and then checks the
+//         claimed positions again
+//       - the other thread claims a position (CAS) and then reads __waiters
+//       (on x86 the seq_cst CAS costs the same as a relaxed one)
+
+template <typename T>
+inline void mpmc_queue<T>::__wake(std::atomic<std::uint32_t>& __epoch,
+                                  std::atomic<std::uint32_t>& __waiters) noexcept
+{
+  if (__waiters.load(std::memory_order_seq_cst) != 0) {
+    __epoch.fetch_add(1, std::memory_order_release);
+    __futex_wake_one(&__epoch);
+  }
+}
+
+template <typename T>
+template <typename _Ready>
+inline void mpmc_queue<T>::__park(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __waiters,
+                                  const stop_token& __stoken, _Ready __ready)
+{
+  // give the other side a chance first, which avoids parking for short delays
+  // (yield instead of spinning, so that this also helps with fewer cores than threads):
+  for (int __i = 0; __i < 4; ++__i) {
+    std::this_thread::yield();
+    if (__ready()) {
+      return;
+    }
+  }
+  __waiters.fetch_add(1, std::memory_order_seq_cst);
+  const std::uint32_t __e = __epoch.load(std::memory_order_seq_cst);
+  if (!__ready()) {
+    // on stop all parked threads are woken up to check their stop_token:
+    stop_callback __cb{__stoken, [&__epoch] {
+                                   __epoch.fetch_add(1, std::memory_order_release);
+                                   __futex_wake_all(&__epoch);
+                                 }};
+    __futex_wait(&__epoch, __e);
+  }
+  __waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool mpmc_queue<T>::push(T value, stop_token stoken)
+{
+  while (!try_push(std::move(value))) {
+    if (stoken.stop_requested()) {
+      return false;
+    }
+    __park(_popEpoch, _pushWaiters, stoken, [this] { return size_approx() <= _mask; });
+  }
+  return true;
+}
+
+template <typename T>
+inline std::optional<T> mpmc_queue<T>::pop(stop_token stoken)
+{
+  for (;;) {
+    if (auto value = try_pop()) {
+      return value;
+    }
+    if (stoken.stop_requested()) {
+      return std::nullopt;
+    }
+    __park(_pushEpoch, _popWaiters, stoken, [this] { return size_approx() > 0; });
+  }
+}
+
+template <typename T>
+inline std::size_t mpmc_queue<T>::size_approx() const noexcept
+{
+  const std::size_t pop = _popPos.load(std::memory_order_seq_cst);
+  const std::size_t push = _pushPos.load(std::memory_order_seq_cst);
+  return push > pop ? push - pop : 0;
+}
+
+
+} // std
+
+#endif // MPMC_QUEUE_HPP
@@ -0,0 +1,276 @@
+// -----------------------------------------------------
+// cancellable parallel algorithms on a thread_pool:
+// -----------------------------------------------------
+#ifndef PARALLEL_ALGORITHM_HPP
+#define PARALLEL_ALGORITHM_HPP
+
+#include "thread_pool.hpp"
+#include "futex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace std {
+
+//*****************************************
+//* common behavior of the parallel algorithms:
+//* - the range is split into chunks, which are claimed in order by the
+//*   calling thread and pool.size()-1 tasks of the pool
+//*   (so the caller may be a worker of the same pool; then, while waiting
+//*    for the pool tasks, it runs queued tasks itself, so that nested calls
+//*    in all workers can't wait for each other)
+//* - the stop_token (and the stop_token of the executing worker) is checked
+//*   once before claiming a chunk, and claimed chunks are always finished,
+//*   so on cancel exactly the elements of a prefix of the range were processed
+//* - the first exception of an element function stops all other chunks
+//*   and is rethrown
+//*****************************************
+
+// info about partial completion:
+struct parallel_for_result {
+  std::size_t processed = 0;    // elements [first, first+processed) were processed
+  bool stopped = false;         // stopped before all elements were processed
+};
+
+template <typename T>
+struct parallel_reduce_result {
+  T value;                      // reduction of init and the processed elements
+  std::size_t processed = 0;
+  bool stopped = false;
+};
+
+//*****************************************
+//* class __parallel_chunks
+//* - runs __fn(chunkIdx, begin, end) for all chunks of [0, __size)
+//* - if __fn returns true, no further chunks are claimed
+//*   (already claimed chunks are still finished)
+//*****************************************
+template <typename _ChunkFn>
+class __parallel_chunks
+{
+    // released when the pool task is destroyed, whether it was executed or discarded
+    // (a stopped thread_pool destroys the tasks not started yet immediately,
+    //  so waiting for the release doesn't depend on the pool's destruction):
+    struct __ticket {
+      __parallel_chunks* __st_;
+      explicit __ticket(__parallel_chunks* __st) noexcept : __st_{__st} {
+      }
+      __ticket(__ticket&& __t) noexcept : __st_{std::exchange(__t.__st_, nullptr)} {
+      }
+      __ticket& operator=(__ticket&&) = delete;
+      ~__ticket() {
+        if (__st_ != nullptr) {
+          __st_->__release();
+        }
+      }
+    };
+
+  public:
+    __parallel_chunks(std::size_t __size, std::size_t __chunk, _ChunkFn& __fn) noexcept
+     : __size_{__size}, __chunk_{__chunk}, __numChunks_{(__size + __chunk - 1) / __chunk}, __fn_{__fn} {
+    }
+
+    // returns the number of chunks processed (always the first ones):
+    std::size_t __run(thread_pool& __pool, const stop_token& __stoken) {
+      stop_callback __onStop{__stoken, [this] { __stop_.request_stop(); }};
+      std::size_t __helpers = std::min<std::size_t>(__pool.size() - 1,
+                                                    __numChunks_ > 0 ? __numChunks_ - 1 : 0);
+      for (std::size_t __i = 0; __i < __helpers; ++__i) {
+        __pending_.fetch_add(1, std::memory_order_relaxed);
+        __pool.submit([__t = __ticket{this}] (stop_token __workerToken) {
+                        __t.__st_->__work(__workerToken);
+                      });
+      }
+      __work(stop_token{});
+      // the pool tasks refer to *this, so wait until all of them are gone:
+      // - a worker of the pool runs queued tasks meanwhile (its own tasks first),
+      //   because all other workers might wait for their tasks as well
+      // - if no task is found, the remaining tasks are executed by other threads
+      std::uint32_t __n;
+      while ((__n = __pending_.load(std::memory_order_acquire)) != 0) {
+        if (!__pool.try_run_task()) {
+          __futex_wait(&__pending_, __n);
+        }
+      }
+      if (__error_) {
+        std::rethrow_exception(__error_);
+      }
+      return std::min(__nextChunk_.load(std::memory_order_relaxed), __numChunks_);
+    }
+
+    std::size_t __processed(std::size_t __chunks) const noexcept {
+      return std::min(__chunks * __chunk_, __size_);
+    }
+
+  private:
+    void __work(const stop_token& __workerToken) {
+      while (!__stop_.stop_requested() && !__workerToken.stop_requested()) {
+        const std::size_t __c = __nextChunk_.fetch_add(1, std::memory_order_relaxed);
+        if (__c >= __numChunks_) {
+          return;
+        }
+        const std::size_t __b = __c * __chunk_;
+        try {
+          if (__fn_(__c, __b, std::min(__b + __chunk_, __size_))) {
+            __stop_.request_stop();
+          }
+        }
+        catch (...) {
+          {
+            std::lock_guard<std::mutex> __lg{__errorMx_};
+            if (!__error_) {
+              __error_ = std::current_exception();
+            }
+          }
+          __stop_.request_stop();
+        }
+      }
+    }
+
+    void __release() noexcept {
+      // after the decrement *this might be gone immediately:
+      std::atomic<std::uint32_t>* __pending = &__pending_;
+      if (__pending->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        __futex_wake_all(__pending);
+      }
+    }
+
+    const std::size_t __size_;
+    const std::size_t __chunk_;
+    const std::size_t __numChunks_;
+    _ChunkFn& __fn_;
+    inplace_stop_source __stop_;
+    alignas(64) std::atomic<std::size_t> __nextChunk_{0};
+    alignas(64) std::atomic<std::uint32_t> __pending_{0};
+    std::mutex __errorMx_;
+    std::exception_ptr __error_;
+};
+
+// default: about 8 chunks per thread to balance load
+inline std::size_t __chunk_size(std::size_t __size, std::size_t __chunk, const thread_pool& __pool) noexcept {
+  if (__chunk == 0) {
+    __chunk = __size / (std::size_t{__pool.size()} * 8);
+  }
+  return std::max<std::size_t>(__chunk, 1);
+}
+
+
+//*****************************************
+//* parallel_for()
+//* - calls fn(elem) for all elements of [first, last)
+//*****************************************
+template <typename RandomIt, typename Fn>
+parallel_for_result parallel_for(thread_pool& pool, RandomIt first, RandomIt last, Fn fn,
+                                 const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  auto chunkFn = [&] (std::size_t, std::size_t b, std::size_t e) {
+                   for (RandomIt it = first + b, end = first + e; it != end; ++it) {
+                     fn(*it);
+                   }
+                   return false;
+                 };
+  __parallel_chunks<decltype(chunkFn)> chunks{size, __chunk_size(size, chunk, pool), chunkFn};
+  const std::size_t processed = chunks.__processed(chunks.__run(pool, stoken));
+  return parallel_for_result{processed, processed < size};
+}
+
+
+//*****************************************
+//* parallel_transform_reduce()
+//* - reduces init and transform(elem) for all elements of [first, last) with reduce
+//* - reduce has to be associative (chunk results are combined in order)
+//*****************************************
+template <typename RandomIt, typename T, typename Reduce, typename Transform>
+parallel_reduce_result<T> parallel_transform_reduce(thread_pool& pool, RandomIt first, RandomIt last,
+                                                    T init, Reduce reduce, Transform transform,
+                                                    const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  chunk = __chunk_size(size, chunk, pool);
+  std::vector<std::optional<T>> partial((size + chunk - 1) / chunk);
+  auto chunkFn = [&] (std::size_t c, std::size_t b, std::size_t e) {
+                   T value = transform(first[b]);
+                   for (std::size_t i = b + 1; i != e; ++i) {
+                     value = reduce(std::move(value), transform(first[i]));
+                   }
+                   partial[c].emplace(std::move(value));
+                   return false;
+                 };
+  __parallel_chunks<decltype(chunkFn)> chunks{size, chunk, chunkFn};
+  const std::size_t numChunks = chunks.__run(pool, stoken);
+  T value = std::move(init);
+  for (std::size_t c = 0; c != numChunks; ++c) {
+    value = reduce(std::move(value), std::move(*partial[c]));
+  }
+  const std::size_t processed = chunks.__processed(numChunks);
+  return parallel_reduce_result<T>{std::move(value), processed, processed < size};
+}
+
+
+//*****************************************
+//* parallel_find_if()
+//* - returns the leftmost element for which pred is true (or last)
+//* - the first match requests stop for the stop source shared by all threads,
+//*   which see it at their next chunk boundary
+//* - as chunks are claimed in order, all chunks before a match were claimed
+//*   before and are still searched completely, so the leftmost match is found
+//* - if stopped by stoken, the result is the leftmost match
+//*   in the prefix searched so far (or last)
+//*****************************************
+template <typename RandomIt, typename Pred>
+RandomIt parallel_find_if(thread_pool& pool, RandomIt first, RandomIt last, Pred pred,
+                          const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  std::atomic<std::size_t> found{size};
+  auto chunkFn = [&] (std::size_t, std::size_t b, std::size_t e) {
+                   for (std::size_t i = b; i != e; ++i) {
+                     if (pred(first[i])) {
+                       // a match in an earlier chunk might have been found concurrently:
+                       std::size_t prev = found.load(std::memory_order_relaxed);
+                       while (i < prev && !found.compare_exchange_weak(prev, i, std::memory_order_relaxed)) {
+                       }
+                       return true;
+                     }
+                   }
+                   return false;
+                 };
+  __parallel_chunks<decltype(chunkFn)> chunks{size, __chunk_size(size, chunk, pool), chunkFn};
+  chunks.__run(pool, stoken);
+  return first + static_cast<typename std::iterator_traits<RandomIt>::difference_type>(found.load());
+}
+
+template <typename RandomIt, typename Pred>
+bool parallel_any_of(thread_pool& pool, RandomIt first, RandomIt last, Pred pred,
+                     const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  return parallel_find_if(pool, first, last, std::move(pred), stoken, chunk) != last;
+}
+
+template <typename RandomIt, typename Pred>
+bool parallel_none_of(thread_pool& pool, RandomIt first, RandomIt last, Pred pred,
+                      const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  return !parallel_any_of(pool, first, last, std::move(pred), stoken, chunk);
+}
+
+template <typename RandomIt, typename Pred>
+bool parallel_all_of(thread_pool& pool, RandomIt first, RandomIt last, Pred pred,
+                     const stop_token& stoken = {}, std::size_t chunk = 0)
+{
+  return !parallel_any_of(pool, first, last,
+                          [&pred] (auto&& elem) { return !pred(std::forward<decltype(elem)>(elem)); },
+                          stoken, chunk);
+}
+
+
+} // std
+
+#endif // PARALLEL_ALGORITHM_HPP
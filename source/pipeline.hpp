@@ -0,0 +1,258 @@
+// -----------------------------------------------------
+// pipeline of stages running on jthreads connected by bounded queues:
+// -----------------------------------------------------
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "bounded_queue.hpp"
+#include "jthread_group.hpp"
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace std {
+
+//*****************************************
+//* class pipeline
+//* - a source produces elements, stages transform them, sinks consume them
+//* - each source/stage/sink runs on its own jthread(s)
+//*   (with multiple threads per stage each thread uses its own copy of the function
+//*    and the order of the elements is no longer preserved)
+//* - stages are connected by bounded queues, so a slow stage blocks the
+//*   stages before it (back-pressure) instead of letting queues grow
+//* - elements are moved between the stages in batches of up to batch elements
+//* - stopping:
+//*   - stop_mode::drain: the sources stop producing, all elements already
+//*     produced are still processed by all stages
+//*   - stop_mode::abort: all threads stop as soon as possible,
+//*     elements in the queues are discarded
+//* - the first exception of any function aborts the pipeline and is rethrown by wait()
+//* - on destruction the pipeline is aborted and all threads are joined
+//*****************************************
+class pipeline
+{
+  public:
+    enum class stop_mode { drain, abort };
+
+    // handle to the output of a source or stage, which is the input of the next stage:
+    template <typename T>
+    class output {
+      public:
+        using value_type = T;
+      private:
+        friend class pipeline;
+        explicit output(bounded_queue<T>* queue) noexcept : _queue{queue} {
+        }
+        bounded_queue<T>* _queue;
+    };
+
+    explicit pipeline(std::size_t capacity = 1024, std::size_t batch = 64)
+     : _capacity{capacity}, _batch{batch > 0 ? batch : 1} {
+    }
+    ~pipeline();
+
+    pipeline(const pipeline&) = delete;
+    pipeline& operator=(const pipeline&) = delete;
+
+    // add a source calling src(stop_token) until it returns no value:
+    // - src returns std::optional<T>
+    // - the passed stop_token signals that the pipeline is stopped
+    template <typename Source>
+    auto add_source(Source src)
+      -> output<typename std::invoke_result_t<Source&, stop_token>::value_type>;
+
+    // add a stage calling fn(elem) for each element of in and passing the result to its output:
+    template <typename T, typename Fn>
+    auto add_stage(output<T> in, Fn fn, unsigned numThreads = 1)
+      -> output<std::invoke_result_t<Fn&, T>>;
+
+    // add a sink calling fn(elem) for each element of in:
+    template <typename T, typename Fn>
+    void add_sink(output<T> in, Fn fn, unsigned numThreads = 1);
+
+    // signal stop to the whole pipeline (without waiting):
+    void request_stop(stop_mode mode = stop_mode::drain) noexcept;
+
+    // wait until all threads are finished:
+    // - rethrows the first exception of any source, stage, or sink
+    void wait();
+
+  private:
+    template <typename T>
+    bounded_queue<T>* __new_queue();
+    void __set_error(std::exception_ptr __e) noexcept;
+
+    const std::size_t _capacity;
+    const std::size_t _batch;
+    std::vector<std::shared_ptr<void>> _queues;
+    stop_source _drainSource;
+    stop_source _abortSource;
+    std::mutex _errorMx;
+    std::exception_ptr _error;
+    jthread_group _threads;  // last member, so that the threads end before the queues are destroyed
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class pipeline
+//*****************************************
+
+inline pipeline::~pipeline()
+{
+  request_stop(stop_mode::abort);
+  _threads.join();
+}
+
+template <typename T>
+inline bounded_queue<T>* pipeline::__new_queue()
+{
+  auto queue = std::make_shared<bounded_queue<T>>(_capacity);
+  _queues.push_back(queue);
+  return queue.get();
+}
+
+inline void pipeline::__set_error(std::exception_ptr __e) noexcept
+{
+  {
+    std::scoped_lock lg{_errorMx};
+    if (!_error) {
+      _error = std::move(__e);
+    }
+  }
+  request_stop(stop_mode::abort);
+}
+
+// NOTE: - blocking queue operations use the abort stop_token
+//         (not the stop_token of the jthread, so that threads can abort the pipeline
+//          while the owner still adds stages to the jthread_group)
+//       - as they still succeed on stop if they don't have to block,
+//         the threads check the abort stop_token before each element
+//       - after finishing, the last thread of a source/stage closes the output,
+//         so that the next stage drains its input and finishes too
+
+template <typename Source>
+inline auto pipeline::add_source(Source src)
+  -> output<typename std::invoke_result_t<Source&, stop_token>::value_type>
+{
+  using T = typename std::invoke_result_t<Source&, stop_token>::value_type;
+  bounded_queue<T>* out = __new_queue<T>();
+  _threads.emplace_back([this, out, src = std::move(src), drainToken = _drainSource.get_token(),
+                         stoken = _abortSource.get_token()] () mutable {
+                          std::vector<T> batch;
+                          batch.reserve(_batch);
+                          try {
+                            bool end = false;
+                            while (!end && !drainToken.stop_requested()) {
+                              batch.clear();
+                              while (batch.size() < _batch && !drainToken.stop_requested()) {
+                                std::optional<T> value = src(drainToken);
+                                if (!value) {
+                                  end = true;
+                                  break;
+                                }
+                                batch.push_back(std::move(*value));
+                              }
+                              // elements produced are still passed on when draining:
+                              if (out->push_batch(batch.begin(), batch.end(), stoken) != batch.end()) {
+                                break;
+                              }
+                            }
+                          }
+                          catch (...) {
+                            __set_error(std::current_exception());
+                          }
+                          out->close();
+                        });
+  return output<T>{out};
+}
+
+template <typename T, typename Fn>
+inline auto pipeline::add_stage(output<T> in, Fn fn, unsigned numThreads)
+  -> output<std::invoke_result_t<Fn&, T>>
+{
+  using U = std::invoke_result_t<Fn&, T>;
+  bounded_queue<U>* out = __new_queue<U>();
+  numThreads = numThreads > 0 ? numThreads : 1;
+  auto running = std::make_shared<std::atomic<unsigned>>(numThreads);
+  for (unsigned i = 0; i < numThreads; ++i) {
+    _threads.emplace_back([this, src = in._queue, out, fn, running,
+                           stoken = _abortSource.get_token()] () mutable {
+                            std::vector<T> inBatch;
+                            std::vector<U> outBatch;
+                            inBatch.reserve(_batch);
+                            outBatch.reserve(_batch);
+                            try {
+                              while (!stoken.stop_requested() && src->pop_batch(inBatch, _batch, stoken) > 0) {
+                                for (auto it = inBatch.begin(); it != inBatch.end() && !stoken.stop_requested(); ++it) {
+                                  outBatch.push_back(fn(std::move(*it)));
+                                }
+                                inBatch.clear();
+                                if (out->push_batch(outBatch.begin(), outBatch.end(), stoken) != outBatch.end()) {
+                                  break;
+                                }
+                                outBatch.clear();
+                              }
+                            }
+                            catch (...) {
+                              __set_error(std::current_exception());
+                            }
+                            if (running->fetch_sub(1) == 1) {
+                              out->close();
+                            }
+                          });
+  }
+  return output<U>{out};
+}
+
+template <typename T, typename Fn>
+inline void pipeline::add_sink(output<T> in, Fn fn, unsigned numThreads)
+{
+  numThreads = numThreads > 0 ? numThreads : 1;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    _threads.emplace_back([this, src = in._queue, fn,
+                           stoken = _abortSource.get_token()] () mutable {
+                            std::vector<T> batch;
+                            batch.reserve(_batch);
+                            try {
+                              while (!stoken.stop_requested() && src->pop_batch(batch, _batch, stoken) > 0) {
+                                for (auto it = batch.begin(); it != batch.end() && !stoken.stop_requested(); ++it) {
+                                  fn(std::move(*it));
+                                }
+                                batch.clear();
+                              }
+                            }
+                            catch (...) {
+                              __set_error(std::current_exception());
+                            }
+                          });
+  }
+}
+
+inline void pipeline::request_stop(stop_mode mode) noexcept
+{
+  _drainSource.request_stop();
+  if (mode == stop_mode::abort) {
+    _abortSource.request_stop();
+  }
+}
+
+inline void pipeline::wait()
+{
+  _threads.join();
+  std::scoped_lock lg{_errorMx};
+  if (_error) {
+    std::rethrow_exception(_error);
+  }
+}
+
+
+} // std
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,323 @@
+// -----------------------------------------------------
+// wait-free bounded SPSC queue with stop_token support:
+// -----------------------------------------------------
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include "stop_token.hpp"
+#include "futex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace std {
+
+//*****************************************
+//* class spsc_queue<T>
+//* - bounded FIFO ring buffer for exactly one producer and one consumer thread
+//* - try_push()/try_pop() are wait-free:
+//*   - producer and consumer index are on separate cache lines
+//*   - each side caches the index of the other side and only reloads it
+//*     if the ring looks full/empty
+//* - the batch operations publish/consume multiple elements with one index update
+//* - push()/pop() block if the queue is full/empty:
+//*   they spin briefly (if there are multiple cores), then yield, and only then park on a futex,
+//*   and return immediately if stop is requested for the passed stop_token
+//* - the capacity is rounded up to a power of two
+//*****************************************
+template <typename T>
+class spsc_queue
+{
+    static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>,
+                  "spsc_queue<T> requires T to be nothrow move constructible and destructible");
+
+  public:
+    explicit spsc_queue(std::size_t capacity);
+    ~spsc_queue();
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    //*** producer side:
+    // - try_push() returns false if full (value is not moved then)
+    // - try_push_batch() pushes as many elements of [first, last) as there is space for
+    //   and returns the position after the last element pushed
+    //   (if an iterator operation throws, the elements pushed before are published)
+    // - push() returns false if stopped before there was space
+    bool try_push(T&& value) noexcept;
+    bool try_push(const T& value) {
+      T copy{value};
+      return try_push(std::move(copy));
+    }
+    template <typename InputIt>
+    InputIt try_push_batch(InputIt first, InputIt last);
+    bool push(T value, stop_token stoken = {});
+
+    //*** consumer side:
+    // - try_pop() returns no value if empty
+    // - try_pop_batch() moves up to max elements to out and returns their number
+    // - pop() returns no value if stopped before an element was available
+    std::optional<T> try_pop() noexcept;
+    template <typename OutputIt>
+    std::size_t try_pop_batch(OutputIt out, std::size_t max);
+    std::optional<T> pop(stop_token stoken = {});
+
+    [[nodiscard]] std::size_t capacity() const noexcept {
+      return _mask + 1;
+    }
+    // approximate number of elements:
+    // - _tail is read first, so that the (later) _head is never behind it
+    [[nodiscard]] std::size_t size_approx() const noexcept {
+      const std::size_t tail = _tail.load(std::memory_order_acquire);
+      const std::size_t head = _head.load(std::memory_order_acquire);
+      return std::min(head - tail, capacity());
+    }
+
+  private:
+    struct __slot {
+      alignas(T) unsigned char __storage[sizeof(T)];
+      T* __ptr() noexcept {
+        return std::launder(reinterpret_cast<T*>(__storage));
+      }
+    };
+
+    void __publish(std::size_t __head) noexcept;
+    void __consume(std::size_t __tail) noexcept;
+    template <typename _Ready>
+    void __wait(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __parked,
+                const stop_token& __stoken, _Ready __ready);
+    static void __wake(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __parked) noexcept;
+
+    static std::size_t __mask_for(std::size_t __capacity) noexcept {
+      std::size_t __n = 2;
+      while (__n < __capacity) {
+        __n <<= 1;
+      }
+      return __n - 1;
+    }
+
+    static constexpr int __spinCount = 256;
+    static constexpr int __yieldCount = 4;
+
+    const std::size_t _mask;
+    const std::unique_ptr<__slot[]> _slots;
+    // producer cache line:
+    alignas(64) std::atomic<std::size_t> _head{0};    // next position to push (published)
+    std::size_t _cachedTail = 0;                      // last known _tail
+    // consumer cache line:
+    alignas(64) std::atomic<std::size_t> _tail{0};    // next position to pop (consumed)
+    std::size_t _cachedHead = 0;                      // last known _head
+    // parking state of each side on its own cache line:
+    // - read by the other side after each publish/consume, but only written
+    //   when a side parks or is woken up, so without blocking the lines stay shared
+    alignas(64) std::atomic<std::uint32_t> _producerParked{0};
+    std::atomic<std::uint32_t> _spaceEpoch{0};        // changes after pops with parked producer
+    alignas(64) std::atomic<std::uint32_t> _consumerParked{0};
+    std::atomic<std::uint32_t> _dataEpoch{0};         // changes after pushes with parked consumer
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class spsc_queue<T>
+//*****************************************
+
+template <typename T>
+inline spsc_queue<T>::spsc_queue(std::size_t capacity)
+ : _mask{__mask_for(capacity)}, _slots{new __slot[_mask + 1]}
+{
+}
+
+template <typename T>
+inline spsc_queue<T>::~spsc_queue()
+{
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    for (std::size_t i = _tail.load(), e = _head.load(); i != e; ++i) {
+      _slots[i & _mask].__ptr()->~T();
+    }
+  }
+}
+
+// NOTE: lost wakeups are avoided by the Dekker-like ordering (all seq_cst):
+//       - the parking side sets its parked flag, reads the epoch, and then checks the other index again
+//       - the other side updates its index and then reads the parked flag
+//       so publishing costs a full barrier, which the batch operations pay once per batch
+
+template <typename T>
+inline void spsc_queue<T>::__publish(std::size_t __head) noexcept
+{
+  _head.store(__head, std::memory_order_seq_cst);
+  __wake(_dataEpoch, _consumerParked);
+}
+
+template <typename T>
+inline void spsc_queue<T>::__consume(std::size_t __tail) noexcept
+{
+  _tail.store(__tail, std::memory_order_seq_cst);
+  __wake(_spaceEpoch, _producerParked);
+}
+
+template <typename T>
+inline void spsc_queue<T>::__wake(std::atomic<std::uint32_t>& __epoch,
+                                  std::atomic<std::uint32_t>& __parked) noexcept
+{
+  if (__parked.load(std::memory_order_seq_cst) != 0) {
+    __epoch.fetch_add(1, std::memory_order_release);
+    __futex_wake_one(&__epoch);
+  }
+}
+
+template <typename T>
+template <typename _Ready>
+inline void spsc_queue<T>::__wait(std::atomic<std::uint32_t>& __epoch, std::atomic<std::uint32_t>& __parked,
+                                  const stop_token& __stoken, _Ready __ready)
+{
+  // spinning only makes sense if the other side can run meanwhile:
+  static const int __spins = std::thread::hardware_concurrency() > 1 ? __spinCount : 0;
+  for (int __i = 0; __i < __spins; ++__i) {
+    if (__ready() || __stoken.stop_requested()) {
+      return;
+    }
+    __spin_yield();
+  }
+  // yield as well, so that the other side can run if it shares the core:
+  for (int __i = 0; __i < __yieldCount; ++__i) {
+    std::this_thread::yield();
+    if (__ready() || __stoken.stop_requested()) {
+      return;
+    }
+  }
+  __parked.store(1, std::memory_order_seq_cst);
+  const std::uint32_t __e = __epoch.load(std::memory_order_seq_cst);
+  if (!__ready()) {
+    stop_callback __cb{__stoken, [&__epoch] {
+                                   __epoch.fetch_add(1, std::memory_order_release);
+                                   __futex_wake_one(&__epoch);
+                                 }};
+    __futex_wait(&__epoch, __e);
+  }
+  __parked.store(0, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool spsc_queue<T>::try_push(T&& value) noexcept
+{
+  const std::size_t head = _head.load(std::memory_order_relaxed);
+  if (head - _cachedTail > _mask) {
+    _cachedTail = _tail.load(std::memory_order_acquire);
+    if (head - _cachedTail > _mask) {
+      return false;
+    }
+  }
+  ::new (static_cast<void*>(_slots[head & _mask].__storage)) T(std::move(value));
+  __publish(head + 1);
+  return true;
+}
+
+template <typename T>
+template <typename InputIt>
+inline InputIt spsc_queue<T>::try_push_batch(InputIt first, InputIt last)
+{
+  const std::size_t head = _head.load(std::memory_order_relaxed);
+  std::size_t h = head;   // counts only constructed elements
+  try {
+    for (; first != last; ++first) {
+      if (h - _cachedTail > _mask) {
+        _cachedTail = _tail.load(std::memory_order_acquire);
+        if (h - _cachedTail > _mask) {
+          break;
+        }
+      }
+      ::new (static_cast<void*>(_slots[h & _mask].__storage)) T(std::move(*first));
+      ++h;
+    }
+  }
+  catch (...) {
+    // the constructed elements have to be destroyed by the consumer or the destructor:
+    if (h != head) {
+      __publish(h);
+    }
+    throw;
+  }
+  if (h != head) {
+    __publish(h);
+  }
+  return first;
+}
+
+template <typename T>
+inline bool spsc_queue<T>::push(T value, stop_token stoken)
+{
+  while (!try_push(std::move(value))) {
+    if (stoken.stop_requested()) {
+      return false;
+    }
+    __wait(_spaceEpoch, _producerParked, stoken,
+           [this] { return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_seq_cst) <= _mask; });
+  }
+  return true;
+}
+
+template <typename T>
+inline std::optional<T> spsc_queue<T>::try_pop() noexcept
+{
+  const std::size_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail == _cachedHead) {
+    _cachedHead = _head.load(std::memory_order_acquire);
+    if (tail == _cachedHead) {
+      return std::nullopt;
+    }
+  }
+  T* p = _slots[tail & _mask].__ptr();
+  std::optional<T> value{std::move(*p)};
+  p->~T();
+  __consume(tail + 1);
+  return value;
+}
+
+template <typename T>
+template <typename OutputIt>
+inline std::size_t spsc_queue<T>::try_pop_batch(OutputIt out, std::size_t max)
+{
+  const std::size_t tail = _tail.load(std::memory_order_relaxed);
+  if (_cachedHead - tail < max) {
+    _cachedHead = _head.load(std::memory_order_acquire);
+  }
+  const std::size_t n = std::min(_cachedHead - tail, max);
+  for (std::size_t i = 0; i < n; ++i) {
+    T* p = _slots[(tail + i) & _mask].__ptr();
+    *out++ = std::move(*p);
+    p->~T();
+  }
+  if (n > 0) {
+    __consume(tail + n);
+  }
+  return n;
+}
+
+template <typename T>
+inline std::optional<T> spsc_queue<T>::pop(stop_token stoken)
+{
+  for (;;) {
+    if (auto value = try_pop()) {
+      return value;
+    }
+    if (stoken.stop_requested()) {
+      return std::nullopt;
+    }
+    __wait(_dataEpoch, _consumerParked, stoken,
+           [this] { return _head.load(std::memory_order_seq_cst) != _tail.load(std::memory_order_relaxed); });
+  }
+}
+
+
+} // std
+
+#endif // SPSC_QUEUE_HPP
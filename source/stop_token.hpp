@@ -46,6 +46,13 @@ struct __stop_callback_base {
 
 struct __stop_state {
  public:
+  __stop_state() noexcept = default;
+
+  // embedded states (see inplace_stop_source) pass a deleter doing nothing
+  // (called indirectly, so that compilers don't see a delete of a non-heap object):
+  explicit __stop_state(void (*__deleter)(__stop_state*) noexcept) noexcept
+   : __deleter_(__deleter) {}
+
   void __add_token_reference() noexcept {
     __state_.fetch_add(__token_ref_increment, std::memory_order_relaxed);
   }
@@ -53,8 +60,9 @@ struct __stop_state {
   void __remove_token_reference() noexcept {
     auto __oldState =
         __state_.fetch_sub(__token_ref_increment, std::memory_order_acq_rel);
-    if (__oldState < (__token_ref_increment + __source_ref_increment)) {
-      delete this;
+    // last reference if there was no source and only this token:
+    if (__oldState < (__token_ref_increment + __token_ref_increment)) {
+      __destroy();
     }
   }
 
@@ -66,7 +74,7 @@ struct __stop_state {
     auto __oldState =
         __state_.fetch_sub(__source_ref_increment, std::memory_order_acq_rel);
     if (__oldState < (__token_ref_increment + __source_ref_increment)) {
-      delete this;
+      __destroy();
     }
   }
 
@@ -211,9 +219,16 @@ struct __stop_state {
     } else {
       // Callback is currently executing on another thread,
       // block until it finishes executing.
-      while (
-          !__cb->__callbackFinishedExecuting_.load(std::memory_order_acquire)) {
-        __spin_yield();
+      // (yield after a while: the callback may just have woken us up,
+      //  so that the signalling thread might not even be running)
+      for (int __spins = 0;
+           !__cb->__callbackFinishedExecuting_.load(std::memory_order_acquire);
+           ++__spins) {
+        if (__spins < 100) {
+          __spin_yield();
+        } else {
+          std::this_thread::yield();
+        }
       }
     }
 
@@ -221,6 +236,14 @@ struct __stop_state {
   }
 
  private:
+  void __destroy() noexcept {
+    __deleter_(this);
+  }
+
+  static void __delete(__stop_state* __state) noexcept {
+    delete __state;
+  }
+
   static bool __is_locked(std::uint64_t __state) noexcept {
     return (__state & __locked_flag) != 0;
   }
@@ -284,7 +307,7 @@ struct __stop_state {
     // indicate that this was the last reference.
     if (__oldState <
         (__locked_flag + __token_ref_increment + __token_ref_increment)) {
-      delete this;
+      __destroy();
     }
   }
 
@@ -301,6 +324,7 @@ struct __stop_state {
   std::atomic<std::uint64_t> __state_{__source_ref_increment};
   __stop_callback_base* __head_ = nullptr;
   std::thread::id __signallingThread_{};
+  void (*__deleter_)(__stop_state*) noexcept = &__stop_state::__delete;
 };
 
 
@@ -309,6 +333,9 @@ struct __stop_state {
 //-----------------------------------------------
 
 class stop_source;
+class inplace_stop_source;
+class jthread;
+struct __jthread_stop_state;
 template <typename _Callback>
 class stop_callback;
 
@@ -388,6 +415,8 @@ class stop_token {
 
  private:
   friend class stop_source;
+  friend class inplace_stop_source;
+  friend struct __jthread_stop_state;
   template <typename _Callback>
   friend class stop_callback;
 
@@ -476,10 +505,54 @@ class stop_source {
   }
 
  private:
+  friend class jthread;
+
+  // adopts a state allocated by a jthread (with its own deleter):
+  explicit stop_source(__stop_state* __state) noexcept : __state_(__state) {}
+
   __stop_state* __state_;
 };
 
 
+//-----------------------------------------------
+// inplace_stop_source
+// - stop_source with the stop state embedded instead of allocated
+// - not copyable or movable and its tokens and callbacks
+//   must not outlive it (use it for stop states of nested operations)
+//-----------------------------------------------
+
+class inplace_stop_source {
+ public:
+  inplace_stop_source() noexcept
+   : __state_([](__stop_state*) noexcept {}) {
+  }
+
+  inplace_stop_source(const inplace_stop_source&) = delete;
+  inplace_stop_source& operator=(const inplace_stop_source&) = delete;
+
+  [[nodiscard]] bool stop_requested() const noexcept {
+    return const_cast<__stop_state&>(__state_).__is_stop_requested();
+  }
+
+  [[nodiscard]] bool stop_possible() const noexcept {
+    return true;
+  }
+
+  bool request_stop() noexcept {
+    return __state_.__request_stop();
+  }
+
+  [[nodiscard]] stop_token get_token() const noexcept {
+    return stop_token{const_cast<__stop_state*>(&__state_)};
+  }
+
+ private:
+  // the initial source reference is never released
+  // and the embedded state is never deleted
+  __stop_state __state_;
+};
+
+
 //-----------------------------------------------
 // stop_callback
 //-----------------------------------------------
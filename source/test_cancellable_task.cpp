@@ -0,0 +1,191 @@
+#include "cancellable_task.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <thread>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testAwaitAlreadyStopped()
+{
+  std::cout << "*** start testAwaitAlreadyStopped()" << std::endl;
+
+  std::stop_source ssrc;
+  ssrc.request_stop();
+  auto coro = [] (std::stop_token st) -> std::task<int> {
+                co_await std::until_stopped(st);   // doesn't suspend
+                co_return 42;
+              };
+  assert(std::sync_wait(coro(ssrc.get_token())) == 42);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testAwaitResumedByRequestStop()
+{
+  // the awaiting coroutine is resumed by the thread calling request_stop()
+  std::cout << "*** start testAwaitResumedByRequestStop()" << std::endl;
+
+  std::stop_source ssrc;
+  std::thread::id resumedBy;
+  std::thread::id stoppedBy;
+  auto coro = [&] () -> std::task<> {
+                co_await std::until_stopped(ssrc.get_token());
+                resumedBy = std::this_thread::get_id();
+              };
+  {
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(100ms);
+                           stoppedBy = std::this_thread::get_id();
+                           ssrc.request_stop();
+                         }};
+    std::sync_wait(coro());
+    assert(ssrc.stop_requested());
+  }
+  assert(resumedBy == stoppedBy);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+std::task<int> leaf(std::atomic<int>& waiting)
+{
+  std::stop_token st = co_await std::get_current_stop_token;
+  assert(st.stop_possible());
+  waiting.fetch_add(1);
+  co_await std::until_stopped(st);
+  co_return 1;
+}
+
+std::task<int> inner(std::atomic<int>& waiting)
+{
+  int a = co_await leaf(waiting);
+  int b = co_await leaf(waiting);   // started only after stop, so doesn't suspend
+  co_return a + b;
+}
+
+std::task<std::string> outer(std::atomic<int>& waiting)
+{
+  int n = co_await inner(waiting);
+  co_return "result " + std::to_string(n);
+}
+
+void testStopTokenPropagation()
+{
+  // the stop_token passed to sync_wait() reaches tasks awaited transitively
+  std::cout << "*** start testStopTokenPropagation()" << std::endl;
+
+  std::stop_source ssrc;
+  std::atomic<int> waiting{0};
+  std::jthread stopper{[&] {
+                         while (waiting.load() == 0) {
+                           std::this_thread::sleep_for(1ms);
+                         }
+                         ssrc.request_stop();
+                       }};
+  assert(std::sync_wait(outer(waiting), ssrc.get_token()) == "result 2");
+  assert(waiting.load() == 2);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+std::task<> failing()
+{
+  co_await std::suspend_never{};
+  throw std::runtime_error{"task failed"};
+}
+
+std::task<int> catching()
+{
+  try {
+    co_await failing();
+  }
+  catch (const std::runtime_error&) {
+    co_return 1;
+  }
+  co_return 0;
+}
+
+void testExceptions()
+{
+  std::cout << "*** start testExceptions()" << std::endl;
+
+  assert(std::sync_wait(catching()) == 1);
+  bool caught = false;
+  try {
+    std::sync_wait(failing());
+  }
+  catch (const std::runtime_error& e) {
+    caught = true;
+    assert(std::string{e.what()} == "task failed");
+  }
+  assert(caught);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+// minimal eagerly started coroutine owning its frame:
+struct EagerCoro {
+  struct promise_type {
+    EagerCoro get_return_object() {
+      return EagerCoro{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+  std::coroutine_handle<promise_type> handle;
+};
+
+void testDestroySuspended()
+{
+  // destroying a coroutine suspended in until_stopped() deregisters the callback
+  std::cout << "*** start testDestroySuspended()" << std::endl;
+
+  std::stop_source ssrc;
+  bool resumed = false;
+  auto coro = [] (std::stop_token st, bool& flag) -> EagerCoro {
+                co_await std::until_stopped(st);
+                flag = true;
+              };
+  EagerCoro c1 = coro(ssrc.get_token(), resumed);
+  EagerCoro c2 = coro(ssrc.get_token(), resumed);
+  assert(!c1.handle.done() && !c2.handle.done());
+  c1.handle.destroy();
+  ssrc.request_stop();
+  assert(resumed);        // c2 was resumed
+  assert(c2.handle.done());
+  c2.handle.destroy();
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testAwaitAlreadyStopped();
+  std::cout << "\n\n**************************\n";
+  testAwaitResumedByRequestStop();
+  std::cout << "\n\n**************************\n";
+  testStopTokenPropagation();
+  std::cout << "\n\n**************************\n";
+  testExceptions();
+  std::cout << "\n\n**************************\n";
+  testDestroySuspended();
+  std::cout << "\n\n**************************\n";
+}
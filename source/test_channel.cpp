@@ -0,0 +1,247 @@
+#include "channel.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testUnbuffered()
+{
+  std::cout << "*** start testUnbuffered()" << std::endl;
+
+  std::channel<std::string> ch;
+  assert(ch.capacity() == 0);
+  std::string s{"hello"};
+  assert(!ch.try_send(std::move(s)));   // no receiver
+  assert(s == "hello");
+  assert(!ch.try_recv());
+
+  std::atomic<bool> received{false};
+  std::jthread receiver{[&] {
+                          std::this_thread::sleep_for(50ms);
+                          for (int i = 0; i < 3; ++i) {
+                            auto v = ch.recv();
+                            assert(v && *v == std::to_string(i));
+                          }
+                          received = true;
+                        }};
+  for (int i = 0; i < 3; ++i) {
+    assert(ch.send(std::to_string(i)));   // blocks until received
+  }
+  receiver.join();
+  assert(received);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testBuffered()
+{
+  std::cout << "*** start testBuffered()" << std::endl;
+
+  std::channel<int> ch{2};
+  assert(ch.try_send(1) && ch.try_send(2));
+  assert(!ch.try_send(3));
+  assert(ch.size() == 2);
+  {
+    // a blocked sender moves into the buffer as soon as there is space:
+    std::jthread sender{[&] {
+                          assert(ch.send(3));
+                        }};
+    std::this_thread::sleep_for(50ms);
+    assert(ch.recv() == 1);
+  }
+  assert(ch.size() == 2);
+  assert(ch.recv() == 2 && ch.recv() == 3);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testClose()
+{
+  std::cout << "*** start testClose()" << std::endl;
+
+  std::channel<int> ch{4};
+  assert(ch.send(1));
+  {
+    // blocked receivers and senders are woken up by close():
+    std::channel<int> toRecv;
+    std::channel<int> toSend;
+    std::jthread receiver{[&] {
+                            assert(!toRecv.recv());
+                          }};
+    std::jthread sender{[&] {
+                          assert(!toSend.send(1));
+                        }};
+    std::this_thread::sleep_for(50ms);
+    toRecv.close();
+    toSend.close();
+  }
+  ch.close();
+  assert(ch.is_closed());
+  assert(!ch.send(2) && !ch.try_send(3));
+  assert(ch.recv() == 1);   // buffered values are still received
+  assert(!ch.recv());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testSelect()
+{
+  std::cout << "*** start testSelect()" << std::endl;
+
+  std::channel<int> ints;
+  std::channel<std::string> strs;
+  std::channel<int> out{1};
+  std::stop_source ssrc;
+
+  // the first ready case is completed:
+  assert(out.try_send(0) == true);
+  int got = 0;
+  std::size_t idx = std::select(ssrc.get_token(),
+                                std::on_recv(ints, [&] (std::optional<int> v) { got = *v; }),
+                                std::on_recv(out, [&] (std::optional<int> v) { got = *v + 100; }));
+  assert(idx == 1 && got == 100);
+
+  // blocking until another thread sends:
+  std::jthread sender{[&] {
+                        std::this_thread::sleep_for(50ms);
+                        assert(strs.send("two"));
+                        assert(ints.send(1));
+                      }};
+  std::string s;
+  idx = std::select(ssrc.get_token(),
+                    std::on_recv(ints, [&] (std::optional<int> v) { got = *v; }),
+                    std::on_recv(strs, [&] (std::optional<std::string> v) { s = *v; }));
+  assert(idx == 1 && s == "two");
+  idx = std::select({},
+                    std::on_recv(ints, [&] (std::optional<int> v) { got = *v; }),
+                    std::on_recv(strs, [&] (std::optional<std::string> v) { s = *v; }));
+  assert(idx == 0 && got == 1);
+
+  // send case:
+  bool sent = false;
+  idx = std::select({}, std::on_recv(ints, [] (std::optional<int>) { assert(false); }),
+                    std::on_send(out, 42, [&] (bool ok) { sent = ok; }));
+  assert(idx == 1 && sent && out.recv() == 42);
+
+  // stop:
+  std::jthread stopper{[&] {
+                         std::this_thread::sleep_for(50ms);
+                         ssrc.request_stop();
+                       }};
+  auto start = std::chrono::steady_clock::now();
+  idx = std::select(ssrc.get_token(),
+                    std::on_recv(ints, [] (std::optional<int>) { assert(false); }),
+                    std::on_recv(strs, [] (std::optional<std::string>) { assert(false); }));
+  assert(idx == std::select_stopped);
+  assert(std::chrono::steady_clock::now() - start < 1s);
+  assert(!ints.recv(ssrc.get_token()));
+
+  // a stopped select left no waiter behind:
+  assert(!ints.try_send(7));
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testSelectWakesOnlyReady()
+{
+  // a send wakes only the selector that can receive it
+  std::cout << "*** start testSelectWakesOnlyReady()" << std::endl;
+
+  constexpr int num = 8;
+  std::vector<std::channel<int>> chs(num);
+  std::channel<int> common;
+  std::atomic<int> done{0};
+  std::stop_source ssrc;
+  {
+    std::vector<std::jthread> selectors;
+    for (int i = 0; i < num; ++i) {
+      selectors.emplace_back([&, i] {
+                               while (std::select(ssrc.get_token(),
+                                                  std::on_recv(chs[i], [&] (std::optional<int>) { ++done; }),
+                                                  std::on_recv(common, [&] (std::optional<int>) { ++done; }))
+                                      != std::select_stopped) {
+                               }
+                             });
+    }
+    std::this_thread::sleep_for(50ms);
+    assert(chs[3].send(3));
+    assert(common.send(0));
+    std::this_thread::sleep_for(50ms);
+    assert(done.load() == 2);
+    ssrc.request_stop();
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testManySendersReceivers()
+{
+  std::cout << "*** start testManySendersReceivers()" << std::endl;
+
+  for (std::size_t capacity : {0u, 1u, 16u}) {
+    std::channel<long> ch{capacity};
+    std::atomic<long> sum{0};
+    std::atomic<int> count{0};
+    constexpr int numPerSender = 20000;
+    {
+      std::vector<std::jthread> threads;
+      for (int r = 0; r < 4; ++r) {
+        threads.emplace_back([&] {
+                               while (auto v = ch.recv()) {
+                                 sum += *v;
+                                 ++count;
+                               }
+                             });
+      }
+      {
+        std::vector<std::jthread> senders;
+        for (int s = 0; s < 4; ++s) {
+          senders.emplace_back([&] {
+                                 for (long i = 1; i <= numPerSender; ++i) {
+                                   assert(ch.send(i));
+                                 }
+                               });
+        }
+      }
+      ch.close();
+    }
+    assert(count.load() == 4 * numPerSender);
+    assert(sum.load() == 4L * numPerSender * (numPerSender + 1) / 2);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testUnbuffered();
+  std::cout << "\n\n**************************\n";
+  testBuffered();
+  std::cout << "\n\n**************************\n";
+  testClose();
+  std::cout << "\n\n**************************\n";
+  testSelect();
+  std::cout << "\n\n**************************\n";
+  testSelectWakesOnlyReady();
+  std::cout << "\n\n**************************\n";
+  testManySendersReceivers();
+  std::cout << "\n\n**************************\n";
+}
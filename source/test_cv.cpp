@@ -9,6 +9,9 @@
 #include <cassert>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 using namespace::std::literals;
 
 // helper to call iwait() and check some assertions
@@ -648,6 +651,426 @@ void testManyCV(bool callNotify, bool callInterrupt)
 
 
 
+//------------------------------------------------------
+
+void testStopWakesOwnWaiter()
+{
+  // a stop only wakes up the waiter using the stopped token:
+  std::cout << "*** start testStopWakesOwnWaiter()" << std::endl;
+
+  constexpr int numWaiters = 8;
+  bool ready = false;
+  std::mutex readyMutex;
+  std::condition_variable_any2 readyCV;
+  std::array<int,numWaiters> numPredCalls{};
+  std::array<bool,numWaiters> result{};
+  std::array<std::stop_source,numWaiters> ssources;
+  {
+    std::vector<std::jthread> vThreads;
+    for (int idx = 0; idx < numWaiters; ++idx) {
+      vThreads.emplace_back([&, idx] {
+                              std::unique_lock lg{readyMutex};
+                              result[idx] = readyCV.wait(lg, ssources[idx].get_token(),
+                                                         [&] { ++numPredCalls[idx]; return ready; });
+                            });
+    }
+    // all waiters are blocked once they checked their predicate (wait nodes are
+    // registered before the lock is released):
+    for (bool allWaiting = false; !allWaiting; ) {
+      std::this_thread::sleep_for(10ms);
+      std::lock_guard lg{readyMutex};
+      allWaiting = std::all_of(numPredCalls.begin(), numPredCalls.end(), [] (int n) { return n > 0; });
+    }
+
+    std::cout << "\n- request_stop() for waiter 0" << std::endl;
+    ssources[0].request_stop();
+    vThreads[0].join();
+    {
+      std::lock_guard lg{readyMutex};
+      assert(!result[0]);
+#ifndef CV_ANY2_FUTEX
+      // (in futex mode a stop wakes up all waiters)
+      for (int idx = 1; idx < numWaiters; ++idx) {
+        assert(numPredCalls[idx] == 1);
+      }
+#endif
+      ready = true;
+    }
+    std::cout << "\n- notify_all() the others" << std::endl;
+    readyCV.notify_all();
+  }
+  for (int idx = 1; idx < numWaiters; ++idx) {
+    assert(result[idx]);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+#ifndef CV_ANY2_FUTEX
+void testNotifyOneOrder()
+{
+  // notify_one() wakes up the oldest waiter (with CV_ANY2_LIFO the newest one):
+  std::cout << "*** start testNotifyOneOrder()" << std::endl;
+
+  constexpr int numWaiters = 5;
+  int tokens = 0;
+  std::vector<int> waiting;   // in order of arrival
+  std::vector<int> woken;     // in order of wakeup
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  {
+    std::vector<std::jthread> vThreads;
+    for (int idx = 0; idx < numWaiters; ++idx) {
+      vThreads.emplace_back([&, idx] {
+                              std::unique_lock lg{mx};
+                              waiting.push_back(idx);
+                              cv.wait(lg, [&] { return tokens > 0; });
+                              --tokens;
+                              woken.push_back(idx);
+                            });
+      // let each waiter block before the next one starts:
+      for (bool blocked = false; !blocked; ) {
+        std::this_thread::sleep_for(10ms);
+        std::lock_guard lg{mx};
+        blocked = static_cast<int>(waiting.size()) == idx + 1;
+      }
+    }
+    for (int n = 1; n <= numWaiters; ++n) {
+      {
+        std::lock_guard lg{mx};
+        ++tokens;
+      }
+      cv.notify_one();
+      for (bool done = false; !done; ) {
+        std::this_thread::sleep_for(1ms);
+        std::lock_guard lg{mx};
+        done = static_cast<int>(woken.size()) == n;
+      }
+    }
+  }
+#ifdef CV_ANY2_LIFO
+  assert(std::equal(woken.begin(), woken.end(), waiting.rbegin()));
+#else
+  assert(woken == waiting);
+#endif
+  std::cout << "\n*** OK" << std::endl;
+}
+#endif
+
+
+//------------------------------------------------------
+
+void testStopWaiter()
+{
+  // many waits with the same stop_waiter:
+  std::cout << "*** start testStopWaiter()" << std::endl;
+
+  int value = 0;
+  int numSeen = 0;
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  {
+    std::jthread t{[&] (std::stop_token stoken) {
+                     std::condition_variable_any2::stop_waiter waiter{cv, stoken};
+                     assert(waiter.get_token() == stoken);
+                     std::unique_lock lg{mx};
+                     int seen = 0;
+                     while (waiter.wait(lg, [&] { return value != seen; })) {
+                       seen = value;
+                       ++numSeen;
+                       cv.notify_all();
+                     }
+                     assert(stoken.stop_requested());
+                     // timed waits return immediately after stop:
+                     assert(!waiter.wait_for(lg, 10s, [] { return false; }));
+                   }};
+    for (int i = 1; i <= 100; ++i) {
+      std::unique_lock lg{mx};
+      value = i;
+      cv.notify_all();
+      cv.wait(lg, [&] { return numSeen == i; });
+    }
+    std::cout << "\n- request_stop()" << std::endl;
+  }
+  assert(numSeen == 100);
+
+  // timeout and stop before the stop_waiter exists:
+  {
+    std::stop_source ssrc;
+    std::condition_variable_any2::stop_waiter waiter{cv, ssrc.get_token()};
+    std::unique_lock lg{mx};
+    assert(!waiter.wait_for(lg, 10ms, [] { return false; }));
+    assert(waiter.wait_for(lg, 10ms, [] { return true; }));
+    ssrc.request_stop();
+    assert(!waiter.wait(lg, [] { return false; }));
+    std::condition_variable_any2::stop_waiter stoppedWaiter{cv, ssrc.get_token()};
+    assert(!stoppedWaiter.wait(lg, [] { return false; }));
+    assert(stoppedWaiter.wait(lg, [] { return true; }));
+  }
+
+  // a stop after a timed out wait doesn't touch the other waiters
+  // (the reused wait node is no longer linked):
+  {
+    std::stop_source ssrc;
+    std::condition_variable_any2::stop_waiter waiter{cv, ssrc.get_token()};
+    bool ready = false;
+    bool waiting = false;
+    auto waitForReady = [&] {
+                          std::unique_lock lg{mx};
+                          waiting = true;
+                          cv.wait(lg, [&] { return ready; });
+                          waiting = false;
+                        };
+    auto untilWaiting = [&] {
+                          for (bool blocked = false; !blocked; ) {
+                            std::this_thread::sleep_for(10ms);
+                            std::lock_guard lg{mx};
+                            blocked = waiting;
+                          }
+                        };
+    // start B before A ends, so that their wait nodes are on different stacks:
+    std::atomic<bool> startB{false};
+    std::jthread tA{waitForReady};
+    std::jthread tB{[&] {
+                      while (!startB.load()) {
+                        std::this_thread::sleep_for(1ms);
+                      }
+                      waitForReady();
+                    }};
+    untilWaiting();
+    {
+      std::unique_lock lg{mx};
+      assert(!waiter.wait_for(lg, 10ms, [] { return false; }));   // linked after waiter A
+      ready = true;
+    }
+    cv.notify_all();
+    tA.join();
+    ready = false;
+    startB = true;
+    untilWaiting();
+    ssrc.request_stop();
+    {
+      std::lock_guard lg{mx};
+      ready = true;
+    }
+    cv.notify_one();
+    tB.join();
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+void testNotifyAllChain()
+{
+  // notify_all() to many waiters with unique_lock<mutex> (waking up one after the other):
+  std::cout << "*** start testNotifyAllChain()" << std::endl;
+
+  constexpr int numWaiters = 8;
+  {
+    bool ready = false;
+    int numDone = 0;
+    std::mutex mx;
+    std::condition_variable_any2 cv;
+    std::vector<std::jthread> vThreads;
+    for (int idx = 0; idx < numWaiters; ++idx) {
+      vThreads.emplace_back([&] {
+                              std::unique_lock lg{mx};
+                              cv.wait(lg, [&] { return ready; });
+                              ++numDone;
+                            });
+    }
+    for (int round = 0; round < 3; ++round) {
+      std::this_thread::sleep_for(20ms);
+      std::unique_lock lg{mx};
+      cv.notify_all();   // spurious for all waiters
+    }
+    {
+      std::unique_lock lg{mx};
+      ready = true;
+      cv.notify_all();
+    }
+    for (auto& t : vThreads) {
+      t.join();
+    }
+    assert(numDone == numWaiters);
+  }
+
+  // destroy the condition variable with the lock held while the waiters are chained:
+  {
+    void* raw = malloc(sizeof(std::condition_variable_any2));
+    auto cv = new(raw) std::condition_variable_any2;
+    std::mutex mx;
+    bool ready = false;
+    int numWaiting = 0;
+    std::vector<std::jthread> vThreads;
+    for (int idx = 0; idx < numWaiters; ++idx) {
+      vThreads.emplace_back([&] {
+                              std::unique_lock lg{mx};
+                              ++numWaiting;
+                              while (!ready) {
+                                cv->wait(lg);
+                              }
+                            });
+    }
+    for (bool allWaiting = false; !allWaiting; ) {
+      std::this_thread::sleep_for(10ms);
+      std::lock_guard lg{mx};
+      allWaiting = numWaiting == numWaiters;
+    }
+    {
+      std::unique_lock lg{mx};
+      ready = true;
+      cv->notify_all();
+      cv->~condition_variable_any2();
+      std::memset(static_cast<void*>(cv), 0x55, sizeof(*cv));
+    }
+    for (auto& t : vThreads) {
+      t.join();
+    }
+    free(raw);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+void testNotifyAllTwoMutexes()
+{
+  // notify_all() to waiters with different mutexes:
+  // - a waiter isn't woken up only after a waiter with another mutex reacquired it
+  std::cout << "*** start testNotifyAllTwoMutexes()" << std::endl;
+
+  // wake order depends on the arrival order, so the waiter with mx1 arrives first or second:
+  for (bool mx1First : {true, false}) {
+    std::mutex mx1;
+    std::mutex mx2;
+    bool ready = false;
+    int numWaiting = 0;
+    std::atomic<bool> done2{false};
+    std::condition_variable_any2 cv;
+    std::mutex countMx;
+    auto waitWith = [&] (std::mutex& mx) {
+                      std::unique_lock lg{mx};
+                      {
+                        std::lock_guard cg{countMx};
+                        ++numWaiting;
+                      }
+                      while (!ready) {
+                        cv.wait(lg);
+                      }
+                    };
+    auto untilWaiting = [&] (int n) {
+                          for (bool allWaiting = false; !allWaiting; ) {
+                            std::this_thread::sleep_for(10ms);
+                            std::lock_guard cg{countMx};
+                            allWaiting = numWaiting == n;
+                          }
+                        };
+    std::vector<std::jthread> vThreads;
+    auto startWaiter = [&] (bool withMx1) {
+                         if (withMx1) {
+                           vThreads.emplace_back([&] { waitWith(mx1); });
+                         }
+                         else {
+                           vThreads.emplace_back([&] { waitWith(mx2); done2 = true; });
+                         }
+                       };
+    startWaiter(mx1First);
+    untilWaiting(1);
+    startWaiter(!mx1First);
+    untilWaiting(2);
+    {
+      // set ready under both mutexes, then notify while holding mx1:
+      std::scoped_lock lg{mx1, mx2};
+      ready = true;
+    }
+    std::unique_lock lg1{mx1};
+    cv.notify_all();
+    auto timeout = std::chrono::steady_clock::now() + 10s;
+    while (!done2.load()) {
+      assert(std::chrono::steady_clock::now() < timeout);
+      std::this_thread::sleep_for(1ms);
+    }
+    lg1.unlock();
+    for (auto& t : vThreads) {
+      t.join();
+    }
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+void testNotifyN()
+{
+  // notify_n() wakes up count waiters (chained ones and ones waiting with a stop_token):
+  std::cout << "*** start testNotifyN()" << std::endl;
+
+  constexpr int numWaiters = 8;
+  int tokens = 0;
+  int numWaiting = 0;
+  int numWakeups = 0;
+  int numDone = 0;
+  std::mutex mx;
+  std::condition_variable_any2 cv;
+  {
+    std::vector<std::jthread> vThreads;
+    for (int idx = 0; idx < numWaiters; ++idx) {
+      vThreads.emplace_back([&, idx] (std::stop_token stoken) {
+                              std::unique_lock lg{mx};
+                              ++numWaiting;
+                              auto hasToken = [&] { return tokens > 0 || (++numWakeups, false); };
+                              if (idx % 2 == 0) {
+                                cv.wait(lg, hasToken);
+                              }
+                              else {
+                                assert(cv.wait(lg, stoken, hasToken));
+                              }
+                              --tokens;
+                              ++numDone;
+                            });
+    }
+    for (bool allWaiting = false; !allWaiting; ) {
+      std::this_thread::sleep_for(10ms);
+      std::lock_guard lg{mx};
+      allWaiting = numWaiting == numWaiters;
+    }
+    std::this_thread::sleep_for(50ms);
+    cv.notify_n(0);
+    {
+      std::lock_guard lg{mx};
+      numWakeups = 0;
+      tokens = 3;
+    }
+    cv.notify_n(3);
+    for (bool done = false; !done; ) {
+      std::this_thread::sleep_for(10ms);
+      std::lock_guard lg{mx};
+      done = numDone == 3;
+    }
+    std::this_thread::sleep_for(50ms);
+    {
+      std::lock_guard lg{mx};
+      assert(numDone == 3);
+#ifndef CV_ANY2_FUTEX
+      assert(numWakeups == 0);   // nobody else woke up
+#endif
+      tokens = numWaiters - 3;
+    }
+    cv.notify_n(100);   // more than waiting
+  }
+  assert(numDone == numWaiters);
+  assert(tokens == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
 //------------------------------------------------------
 
 int main()
@@ -727,6 +1150,21 @@ int main()
   testManyCV<9>(false, true);  // don't call notify, call request_stop()
   std::cout << "\n\n**************************\n";
   testManyCV<9>(false, false); // don't call notify, don't call request_stop() (implicit interrupt)
+
+  std::cout << "\n\n**************************\n";
+  testStopWakesOwnWaiter();
+  std::cout << "\n\n**************************\n";
+  testStopWaiter();
+  std::cout << "\n\n**************************\n";
+  testNotifyAllChain();
+  std::cout << "\n\n**************************\n";
+  testNotifyAllTwoMutexes();
+  std::cout << "\n\n**************************\n";
+  testNotifyN();
+#ifndef CV_ANY2_FUTEX
+  std::cout << "\n\n**************************\n";
+  testNotifyOneOrder();
+#endif
  }
  catch (const std::exception& e) {
    std::cerr << "EXCEPTION: " << e.what() << std::endl;
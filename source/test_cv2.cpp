@@ -0,0 +1,194 @@
+#include "condition_variable2.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <chrono>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testNotifyWait()
+{
+  std::cout << "*** start testNotifyWait()" << std::endl;
+
+  std::mutex mx;
+  std::condition_variable2 cv;
+  int value = 0;
+  int sum = 0;
+  {
+    std::jthread consumer{[&] {
+                            std::unique_lock lg{mx};
+                            for (int expected = 1; expected <= 100; ++expected) {
+                              cv.wait(lg, [&] { return value == expected; });
+                              sum += value;
+                              cv.notify_one();
+                            }
+                          }};
+    for (int i = 1; i <= 100; ++i) {
+      std::unique_lock lg{mx};
+      value = i;
+      cv.notify_one();
+      cv.wait(lg, [&] { return sum == i * (i + 1) / 2; });
+    }
+  }
+  assert(sum == 5050);
+
+  // notify_all() to many waiters:
+  {
+    bool ready = false;
+    int numDone = 0;
+    std::vector<std::jthread> vThreads;
+    for (int i = 0; i < 8; ++i) {
+      vThreads.emplace_back([&] {
+                              std::unique_lock lg{mx};
+                              cv.wait(lg, [&] { return ready; });
+                              ++numDone;
+                            });
+    }
+    std::this_thread::sleep_for(50ms);
+    {
+      std::lock_guard lg{mx};
+      ready = true;
+    }
+    cv.notify_all();
+    for (auto& t : vThreads) {
+      t.join();
+    }
+    assert(numDone == 8);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testTimedWait()
+{
+  std::cout << "*** start testTimedWait()" << std::endl;
+
+  std::mutex mx;
+  std::condition_variable2 cv;
+  std::unique_lock lg{mx};
+  auto t0 = std::chrono::steady_clock::now();
+  assert(!cv.wait_for(lg, 100ms, [] { return false; }));
+  assert(std::chrono::steady_clock::now() >= t0 + 100ms);
+  assert(lg.owns_lock());
+  assert(cv.wait_until(lg, std::chrono::system_clock::now() + 10ms) == std::cv_status::timeout);
+  assert(cv.wait_for(lg, 1h, [] { return true; }));
+
+  // notified before the timeout:
+  bool ready = false;
+  std::jthread t{[&] {
+                   std::this_thread::sleep_for(50ms);
+                   std::lock_guard lg2{mx};
+                   ready = true;
+                   cv.notify_one();
+                 }};
+  t0 = std::chrono::steady_clock::now();
+  assert(cv.wait_for(lg, 10s, [&] { return ready; }));
+  assert(std::chrono::steady_clock::now() < t0 + 5s);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testStopWait()
+{
+  std::cout << "*** start testStopWait()" << std::endl;
+
+  std::mutex mx;
+  std::condition_variable2 cv;
+  bool untimedResult = true;
+  bool timedResult = true;
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    std::jthread t1{[&] (std::stop_token stoken) {
+                      std::unique_lock lg{mx};
+                      untimedResult = cv.wait(lg, stoken, [] { return false; });
+                      assert(lg.owns_lock());
+                    }};
+    std::jthread t2{[&] (std::stop_token stoken) {
+                      std::unique_lock lg{mx};
+                      timedResult = cv.wait_for(lg, stoken, 10s, [] { return false; });
+                      assert(lg.owns_lock());
+                    }};
+    std::this_thread::sleep_for(100ms);
+  } // request_stop() and join
+  assert(!untimedResult);
+  assert(!timedResult);
+  assert(std::chrono::steady_clock::now() < t0 + 5s);
+
+  // stop already requested:
+  std::stop_source ssrc;
+  ssrc.request_stop();
+  std::unique_lock lg{mx};
+  assert(!cv.wait(lg, ssrc.get_token(), [] { return false; }));
+  assert(cv.wait(lg, ssrc.get_token(), [] { return true; }));
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testDestroyWhileNotified()
+{
+  // (as test_cvrace_hh and test_cvrace_stop for condition_variable_any2)
+  std::cout << "*** start testDestroyWhileNotified()" << std::endl;
+
+  for (bool withStop : {false, true}) {
+    void* raw = malloc(sizeof(std::condition_variable2));
+    auto cv = new(raw) std::condition_variable2;
+    std::mutex mx;
+    std::stop_source ssrc;
+    bool ready = false;
+    bool waiting = false;
+    std::jthread waiter{[&] {
+                          std::unique_lock lg{mx};
+                          waiting = true;
+                          if (withStop) {
+                            cv->wait(lg, ssrc.get_token(), [&] { return ready; });
+                          }
+                          else {
+                            cv->wait(lg, [&] { return ready; });
+                          }
+                        }};
+    for (bool isWaiting = false; !isWaiting; ) {
+      std::this_thread::sleep_for(10ms);
+      std::lock_guard lg{mx};
+      isWaiting = waiting;
+    }
+    {
+      std::unique_lock lg{mx};
+      ready = true;
+      cv->notify_all();
+      cv->~condition_variable2();
+      std::memset(static_cast<void*>(cv), 0x55, sizeof(*cv));
+      ssrc.request_stop();
+    }
+    waiter.join();
+    free(raw);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testNotifyWait();
+  std::cout << "\n\n**************************\n";
+  testTimedWait();
+  std::cout << "\n\n**************************\n";
+  testStopWait();
+  std::cout << "\n\n**************************\n";
+  testDestroyWhileNotified();
+  std::cout << "\n\n**************************\n";
+}
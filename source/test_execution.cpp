@@ -0,0 +1,275 @@
+#include "execution.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+using namespace::std::literals;
+namespace ex = std::execution;
+
+//------------------------------------------------------
+
+// count allocations to verify that composing senders doesn't allocate:
+std::atomic<long> numAllocs{0};
+
+void* operator new(std::size_t size)
+{
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+//------------------------------------------------------
+
+// sender completing with set_stopped() only when stop is requested:
+struct WaitStopped {
+  using value_type = void;
+
+  template <typename Receiver>
+  struct Op {
+    struct OnStop {
+      Op* op;
+      void operator()() noexcept {
+        op->complete();
+      }
+    };
+    void start() noexcept {
+      cb.emplace(rcvr.get_stop_token(), OnStop{this});
+      complete();
+    }
+    void complete() noexcept {
+      // whoever comes second (start() or the callback) completes:
+      if (flag.exchange(true)) {
+        rcvr.set_stopped();
+      }
+    }
+    Receiver rcvr;
+    std::atomic<bool> flag{false};
+    std::optional<std::stop_callback<OnStop>> cb{};
+  };
+
+  template <typename Receiver>
+  Op<Receiver> connect(Receiver r) && {
+    return Op<Receiver>{std::move(r)};
+  }
+};
+
+//------------------------------------------------------
+
+void testJustThen()
+{
+  std::cout << "*** start testJustThen()" << std::endl;
+
+  auto r1 = ex::sync_wait(ex::then(ex::just(20), [] (int i) { return i + 1; }));
+  assert(r1 && *r1 == 21);
+
+  bool called = false;
+  auto r2 = ex::sync_wait(ex::then(ex::just(), [&] { called = true; }));
+  static_assert(std::is_same_v<decltype(r2), std::optional<std::monostate>>);
+  assert(r2 && called);
+
+  bool caught = false;
+  try {
+    ex::sync_wait(ex::then(ex::just(1), [] (int) -> int { throw std::runtime_error{"oops"}; }));
+  }
+  catch (const std::runtime_error&) {
+    caught = true;
+  }
+  assert(caught);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testLetValue()
+{
+  std::cout << "*** start testLetValue()" << std::endl;
+
+  auto r = ex::sync_wait(ex::let_value(ex::just(3),
+                                       [] (int& i) {
+                                         // i lives until the returned sender completes:
+                                         return ex::then(ex::just(), [&i] { return i * 2; });
+                                       }));
+  assert(r && *r == 6);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testWhenAllValues()
+{
+  std::cout << "*** start testWhenAllValues()" << std::endl;
+
+  auto r = ex::sync_wait(ex::when_all(ex::just(1), ex::just(), ex::just("two"s)));
+  static_assert(std::is_same_v<decltype(r), std::optional<std::tuple<int, std::string>>>);
+  assert(r && std::get<0>(*r) == 1 && std::get<1>(*r) == "two");
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testWhenAllCancelsSiblings()
+{
+  // the first error requests stop for all siblings, then the error is reported
+  std::cout << "*** start testWhenAllCancelsSiblings()" << std::endl;
+
+  ex::jthread_context ctx;
+  bool caught = false;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    ex::sync_wait(ex::when_all(WaitStopped{},
+                               ex::then(ctx.get_scheduler().schedule(),
+                                        [] { throw std::runtime_error{"failed"}; }),
+                               WaitStopped{}));
+  }
+  catch (const std::runtime_error& e) {
+    caught = true;
+    assert(std::string{e.what()} == "failed");
+  }
+  assert(caught);
+  assert(std::chrono::steady_clock::now() - start < 1s);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testStopPropagation()
+{
+  // stop requests of the environment reach all nested operations
+  std::cout << "*** start testStopPropagation()" << std::endl;
+
+  {
+    std::stop_source ssrc;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           ssrc.request_stop();
+                         }};
+    auto r = ex::sync_wait(ex::let_value(ex::just(),
+                                         [] {
+                                           return ex::when_all(WaitStopped{}, ex::just(1), WaitStopped{});
+                                         }),
+                           ssrc.get_token());
+    assert(!r);
+  }
+  {
+    // stop_when() adds another stop_token:
+    std::stop_source trigger;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           trigger.request_stop();
+                         }};
+    auto r = ex::sync_wait(ex::stop_when(WaitStopped{}, trigger.get_token()));
+    assert(!r);
+  }
+  {
+    // stop already requested:
+    std::stop_source ssrc;
+    ssrc.request_stop();
+    auto r = ex::sync_wait(ex::stop_when(WaitStopped{}, std::stop_token{}), ssrc.get_token());
+    assert(!r);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testScheduler()
+{
+  std::cout << "*** start testScheduler()" << std::endl;
+
+  ex::jthread_context ctx;
+  auto sched = ctx.get_scheduler();
+  auto r = ex::sync_wait(ex::then(sched.schedule(), [] { return std::this_thread::get_id(); }));
+  assert(r && *r == ctx.get_id());
+
+  // work scheduled when stop was requested completes with set_stopped():
+  std::stop_source ssrc;
+  ssrc.request_stop();
+  auto r2 = ex::sync_wait(sched.schedule(), ssrc.get_token());
+  assert(!r2);
+
+  // work scheduled after the context was stopped completes with set_stopped()
+  // (instead of never completing):
+  ctx.request_stop();
+  auto r3 = ex::sync_wait(ex::then(sched.schedule(), [] { return 42; }));
+  assert(!r3);
+  auto r4 = ex::sync_wait(ex::when_all(sched.schedule(), ex::just(1)));
+  assert(!r4);
+
+  // run_loop driven by the current thread:
+  ex::run_loop loop;
+  std::jthread other{[&] {
+                       auto r = ex::sync_wait(ex::then(loop.get_scheduler().schedule(),
+                                                       [] { return std::this_thread::get_id(); }));
+                       loop.finish();
+                       assert(r && *r != std::this_thread::get_id());
+                     }};
+  loop.run();
+  other.join();
+  assert(!ex::sync_wait(loop.get_scheduler().schedule()));
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testNoAllocation()
+{
+  std::cout << "*** start testNoAllocation()" << std::endl;
+
+  std::stop_source ssrc;
+  std::stop_source trigger;
+  long before = numAllocs.load();
+  auto r = ex::sync_wait(ex::stop_when(ex::when_all(ex::then(ex::just(1), [] (int i) { return i + 1; }),
+                                                    ex::let_value(ex::just(2),
+                                                                  [] (int& i) { return ex::just(i); })),
+                                       trigger.get_token()),
+                         ssrc.get_token());
+  long allocs = numAllocs.load() - before;
+  assert(r && *r == std::make_tuple(2, 2));
+  std::cout << "  " << allocs << " allocations" << std::endl;
+  assert(allocs == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testJustThen();
+  std::cout << "\n\n**************************\n";
+  testLetValue();
+  std::cout << "\n\n**************************\n";
+  testWhenAllValues();
+  std::cout << "\n\n**************************\n";
+  testWhenAllCancelsSiblings();
+  std::cout << "\n\n**************************\n";
+  testStopPropagation();
+  std::cout << "\n\n**************************\n";
+  testScheduler();
+  std::cout << "\n\n**************************\n";
+  testNoAllocation();
+  std::cout << "\n\n**************************\n";
+}
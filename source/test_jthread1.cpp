@@ -4,6 +4,8 @@
 #include <chrono>
 #include <cassert>
 #include <atomic>
+#include <memory>
+#include <system_error>
 using namespace::std::literals;
 
 //------------------------------------------------------
@@ -446,6 +448,209 @@ void testJThreadAPI()
 }
 
 
+//------------------------------------------------------
+
+void testTryJoin()
+{
+  // test timed joins
+  std::cout << "\n*** start testTryJoin()" << std::endl;
+
+  std::jthread t0;
+  try {
+    t0.try_join_for(1ms);
+    assert(false);
+  }
+  catch (const std::system_error& e) {
+    assert(e.code() == std::errc::invalid_argument);
+  }
+
+  std::atomic<bool> finish{false};
+  std::jthread t1([&finish] {
+                    while (!finish.load()) {
+                      std::this_thread::sleep_for(10ms);
+                    }
+                  });
+  auto start = std::chrono::steady_clock::now();
+  assert(!t1.try_join_for(100ms));
+  assert(std::chrono::steady_clock::now() - start >= 100ms);
+  assert(t1.joinable());
+  assert(!t1.try_join_until(std::chrono::system_clock::now() + 50ms));
+  assert(!t1.try_join_until(std::chrono::steady_clock::now() - 1s));  // deadline passed
+  assert(t1.joinable());
+
+  finish.store(true);
+  start = std::chrono::steady_clock::now();
+  assert(t1.try_join_for(10s));
+  assert(std::chrono::steady_clock::now() - start < 5s);   // woken up, no full timeout
+  assert(!t1.joinable());
+
+  // finished threads join immediately:
+  std::jthread t2([] {});
+  std::this_thread::sleep_for(50ms);
+  assert(t2.try_join_until(std::chrono::steady_clock::now()));
+  assert(!t2.joinable());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testJoinTimeout()
+{
+  // test the join deadline of the destructor
+  std::cout << "\n*** start testJoinTimeout()" << std::endl;
+
+  auto finish = std::make_shared<std::atomic<bool>>(false);
+  auto finished = std::make_shared<std::atomic<bool>>(false);
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread t1([finish, finished] {   // ignores stop requests
+                      while (!finish->load()) {
+                        std::this_thread::sleep_for(10ms);
+                      }
+                      finished->store(true);
+                    });
+    assert(t1.get_join_timeout() == std::chrono::steady_clock::duration::max());
+    t1.set_join_timeout(200ms);
+    assert(t1.get_join_timeout() == 200ms);
+  } // destructor detaches t1 after 200ms
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  assert(elapsed >= 200ms && elapsed < 5s);
+  assert(!finished->load());
+  finish->store(true);
+
+  // the deadline does not matter if the thread reacts in time:
+  std::stop_token stoken;
+  start = std::chrono::steady_clock::now();
+  {
+    std::jthread t2([] (std::stop_token st) {
+                      while (!st.stop_requested()) {
+                        std::this_thread::sleep_for(10ms);
+                      }
+                    });
+    t2.set_join_timeout(10s);
+    stoken = t2.get_stop_token();
+  }
+  assert(stoken.stop_requested());
+  assert(std::chrono::steady_clock::now() - start < 5s);
+
+  // the deadline is moved with the thread:
+  std::jthread t3([] {});
+  t3.set_join_timeout(1s);
+  std::jthread t4{std::move(t3)};
+  assert(t4.get_join_timeout() == 1s);
+  t4.join();
+  while (!finished->load()) {   // wait for the detached thread
+    std::this_thread::sleep_for(10ms);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+void testInterruptibleSleep()
+{
+  // test this_thread::sleep_for()/sleep_until() with stop_token
+  std::cout << "\n*** start testInterruptibleSleep()" << std::endl;
+
+  // without stop request the full time elapses:
+  std::stop_source ssource;
+  auto start = std::chrono::steady_clock::now();
+  assert(std::this_thread::sleep_for(100ms, ssource.get_token()));
+  assert(std::chrono::steady_clock::now() - start >= 100ms);
+  start = std::chrono::steady_clock::now();
+  assert(std::this_thread::sleep_until(std::chrono::system_clock::now() + 50ms, ssource.get_token()));
+  assert(std::chrono::steady_clock::now() - start >= 40ms);
+  assert(std::this_thread::sleep_for(0ms, ssource.get_token()));
+  assert(std::this_thread::sleep_for(10ms, std::stop_token{}));
+
+  // stop requests end the sleep immediately:
+  std::atomic<std::chrono::steady_clock::time_point> stopTime;
+  std::chrono::steady_clock::duration latency{};
+  {
+    std::jthread t1([&] (std::stop_token st) {
+                      // NOTE: would take 100s without stop request
+                      while (std::this_thread::sleep_for(100ms, st)) {
+                      }
+                      latency = std::chrono::steady_clock::now() - stopTime.load();
+                    });
+    std::this_thread::sleep_for(250ms);
+    stopTime = std::chrono::steady_clock::now();
+    start = stopTime;
+  } // destructor signals stop
+  // (generous bound for loaded machines; the measured latency is printed below)
+  assert(std::chrono::steady_clock::now() - start < 5s);
+  std::cout << "  stop latency: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(latency).count() << "us" << std::endl;
+
+  // already stopped tokens don't sleep at all:
+  ssource.request_stop();
+  start = std::chrono::steady_clock::now();
+  assert(!std::this_thread::sleep_for(10s, ssource.get_token()));
+  assert(!std::this_thread::sleep_until(std::chrono::steady_clock::now() + 10s, ssource.get_token()));
+  assert(std::chrono::steady_clock::now() - start < 5s);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+bool deeplyNestedCheck(int depth)
+{
+  // no stop_token passed, so use the one of the current jthread:
+  if (depth > 0) {
+    return deeplyNestedCheck(depth-1);
+  }
+  return std::this_thread::stop_requested();
+}
+
+void testThisThreadStopToken()
+{
+  // test this_thread::get_stop_token()
+  std::cout << "\n*** start testThisThreadStopToken()" << std::endl;
+
+  // threads not started by jthread have no stop_token:
+  assert(!std::this_thread::get_stop_token().stop_possible());
+  assert(!std::this_thread::stop_requested());
+  std::thread{[] {
+                assert(!std::this_thread::get_stop_token().stop_possible());
+              }}.join();
+
+  std::atomic<bool> t1Ready{false};
+  std::atomic<bool> t1StopSeen{false};
+  std::stop_token t1Token;
+  std::jthread t1([&] {   // NOTE: no stop_token passed
+                    t1Token = std::this_thread::get_stop_token();
+                    // no copy of the stop_token per call:
+                    assert(&std::this_thread::get_stop_token() == &std::this_thread::get_stop_token());
+                    t1Ready.store(true);
+                    while (!deeplyNestedCheck(10)) {
+                      std::this_thread::sleep_for(1ms);
+                    }
+                    t1StopSeen.store(true);
+                  });
+  std::stop_token t2Token;
+  std::jthread t2([&] (std::stop_token st) {
+                    t2Token = std::this_thread::get_stop_token();
+                    assert(t2Token == st);
+                    std::this_thread::sleep_for(10s, std::this_thread::get_stop_token());
+                  });
+  while (!t1Ready.load()) {
+    std::this_thread::sleep_for(1ms);
+  }
+  assert(t1Token == t1.get_stop_token());
+  assert(!t1StopSeen.load());
+  t1.request_stop();
+  t1.join();
+  assert(t1StopSeen.load());
+  t2.request_stop();
+  t2.join();
+  assert(t2Token == t2.get_stop_token());
+  assert(!std::this_thread::stop_requested());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
 //------------------------------------------------------
 //------------------------------------------------------
 
@@ -473,5 +678,13 @@ int main()
   std::cout << "\n\n**************************\n";
   testJThreadAPI();
   std::cout << "\n\n**************************\n";
+  testTryJoin();
+  std::cout << "\n\n**************************\n";
+  testJoinTimeout();
+  std::cout << "\n\n**************************\n";
+  testInterruptibleSleep();
+  std::cout << "\n\n**************************\n";
+  testThisThreadStopToken();
+  std::cout << "\n\n**************************\n";
 }
 
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <cassert>
 #include <atomic>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 using namespace::std::literals;
 
@@ -379,6 +381,149 @@ void testEnabledIfForCopyConstructor_CompileTimeOnly()
 }
 
 
+//------------------------------------------------------
+
+void testSpawnResult()
+{
+  std::cout << "\n*** start testSpawnResult()" << std::endl;
+  {
+    // value result:
+    auto h1 = std::jthread::spawn([] (int a, int b) { return a * b; }, 6, 7);
+    static_assert(std::is_same_v<decltype(h1), std::jthread_handle<int>>);
+    assert(h1.joinable());
+    assert(h1.join() == 42);
+    assert(!h1.joinable());
+
+    // callable taking a stop_token:
+    auto h2 = std::jthread::spawn([] (std::stop_token st, std::string s) {
+                                    int n = 0;
+                                    while (!st.stop_requested()) {
+                                      std::this_thread::sleep_for(1ms);
+                                      ++n;
+                                    }
+                                    return s + " stopped";
+                                  }, "h2");
+    assert(h2.get_stop_token().stop_possible());
+    assert(!h2.wait_for(20ms));
+    h2.request_stop();
+    assert(h2.wait_for(10s));
+    assert(h2.join() == "h2 stopped");
+
+    // move-only result:
+    auto h3 = std::jthread::spawn([] { return std::make_unique<int>(3); });
+    std::unique_ptr<int> up = h3.join();
+    assert(up && *up == 3);
+
+    // reference result:
+    int value = 0;
+    auto h4 = std::jthread::spawn([&value] () -> int& { return value; });
+    int& ref = h4.join();
+    assert(&ref == &value);
+
+    // void result:
+    std::atomic<bool> done{false};
+    auto h5 = std::jthread::spawn([&done] { done = true; });
+    static_assert(std::is_same_v<decltype(h5.join()), void>);
+    h5.join();
+    assert(done);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testSpawnException()
+{
+  std::cout << "\n*** start testSpawnException()" << std::endl;
+  {
+    auto h1 = std::jthread::spawn([] () -> int { throw std::runtime_error{"oops"}; });
+    try {
+      h1.join();
+      assert(false);
+    }
+    catch (const std::runtime_error& e) {
+      assert(std::string{e.what()} == "oops");
+    }
+    assert(!h1.joinable());
+
+    auto h2 = std::jthread::spawn([] { throw 42; });
+    try {
+      h2.join();
+      assert(false);
+    }
+    catch (int i) {
+      assert(i == 42);
+    }
+
+    // destructor stops and joins, an exception is discarded:
+    std::stop_token st;
+    {
+      auto h3 = std::jthread::spawn([] (std::stop_token st) {
+                                      while (!st.stop_requested()) {
+                                        std::this_thread::sleep_for(1ms);
+                                      }
+                                      throw std::runtime_error{"stopped"};
+                                    });
+      st = h3.get_stop_token();
+    }
+    assert(st.stop_requested());
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
+//------------------------------------------------------
+
+void testPropagateExceptions()
+{
+  std::cout << "\n*** start testPropagateExceptions()" << std::endl;
+  {
+    // join() rethrows:
+    std::jthread t1{std::propagate_exceptions,
+                    [] (int i) { throw std::runtime_error{"t1 failed: " + std::to_string(i)}; },
+                    1};
+    try {
+      t1.join();
+      assert(false);
+    }
+    catch (const std::runtime_error& e) {
+      assert(std::string{e.what()} == "t1 failed: 1");
+    }
+    assert(!t1.joinable());
+
+    // try_join_for() rethrows:
+    std::jthread t2{std::propagate_exceptions,
+                    [] (std::stop_token st) {
+                      while (!st.stop_requested()) {
+                        std::this_thread::sleep_for(1ms);
+                      }
+                      throw 2;
+                    }};
+    assert(!t2.try_join_for(10ms));
+    t2.request_stop();
+    try {
+      t2.try_join_for(10s);
+      assert(false);
+    }
+    catch (int i) {
+      assert(i == 2);
+    }
+    assert(!t2.joinable());
+
+    // no exception, no problem:
+    std::jthread t3{std::propagate_exceptions, [] {}};
+    t3.join();
+
+    // destructor (and move assignment) discard the exception:
+    std::jthread t4{std::propagate_exceptions, [] { throw 4; }};
+    std::jthread t5{std::propagate_exceptions, [] { throw 5; }};
+    std::this_thread::sleep_for(10ms);
+    t4 = std::move(t5);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+
 //------------------------------------------------------
 
 int main()
@@ -405,5 +550,11 @@ int main()
   std::cout << "\n**************************\n\n";
   testEnabledIfForCopyConstructor_CompileTimeOnly();
   std::cout << "\n**************************\n\n";
+  testSpawnResult();
+  std::cout << "\n**************************\n\n";
+  testSpawnException();
+  std::cout << "\n**************************\n\n";
+  testPropagateExceptions();
+  std::cout << "\n**************************\n\n";
 }
 
@@ -0,0 +1,196 @@
+#include "jthread_group.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testGroupStopAll()
+{
+  std::cout << "*** start testGroupStopAll()" << std::endl;
+
+  std::atomic<int> started{0};
+  std::atomic<int> stopped{0};
+  {
+    std::jthread_group group;
+    assert(group.empty());
+    for (int i = 0; i < 10; ++i) {
+      group.emplace_back([&] (std::stop_token st) {
+                           started.fetch_add(1);
+                           while (!st.stop_requested()) {
+                             std::this_thread::sleep_for(1ms);
+                           }
+                           stopped.fetch_add(1);
+                         });
+    }
+    assert(group.size() == 10);
+    while (started.load() < 10) {
+      std::this_thread::sleep_for(1ms);
+    }
+    assert(stopped.load() == 0);
+  } // destructor signals stop to all threads and joins them
+  assert(stopped.load() == 10);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testGroupArgs()
+{
+  std::cout << "*** start testGroupArgs()" << std::endl;
+
+  std::atomic<int> sum{0};
+  {
+    std::jthread_group group;
+    group.emplace_back([&sum] (int a, int b) { sum += a + b; }, 1, 2);
+    group.emplace_back([&sum] (std::stop_token st, int a) {
+                         assert(st.stop_possible());
+                         sum += a;
+                       }, 10);
+    group.join();
+    assert(!group[0].joinable());
+    assert(!group[1].joinable());
+  }
+  assert(sum.load() == 13);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testGroupJoinUntil()
+{
+  std::cout << "*** start testGroupJoinUntil()" << std::endl;
+
+  std::atomic<bool> release{false};
+  std::jthread_group group;
+  for (int i = 0; i < 3; ++i) {
+    group.emplace_back([] (std::stop_token st) {
+                         while (!st.stop_requested()) {
+                           std::this_thread::sleep_for(1ms);
+                         }
+                       });
+  }
+  // a thread ignoring stop requests:
+  auto stuckId = group.emplace_back([&release] {
+                                      while (!release.load()) {
+                                        std::this_thread::sleep_for(1ms);
+                                      }
+                                    }).get_id();
+
+  // nobody finishes without a stop request:
+  auto stragglers = group.join_for(50ms);
+  assert(stragglers.size() == 4);
+
+  group.request_stop();
+  auto start = std::chrono::steady_clock::now();
+  stragglers = group.join_for(2s);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  assert(stragglers.size() == 1);
+  assert(stragglers[0] == stuckId);
+  assert(elapsed >= 2s);
+  assert(!group[0].joinable() && !group[1].joinable() && !group[2].joinable());
+  assert(group[3].joinable());
+
+  // a straggler finishing before the deadline ends the wait early:
+  std::jthread releaser{[&release] {
+                          std::this_thread::sleep_for(100ms);
+                          release.store(true);
+                        }};
+  start = std::chrono::steady_clock::now();
+  stragglers = group.join_for(10s);
+  elapsed = std::chrono::steady_clock::now() - start;
+  assert(stragglers.empty());
+  assert(elapsed < 5s);
+  assert(!group[3].joinable());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testGroupExceptions()
+{
+  std::cout << "*** start testGroupExceptions()" << std::endl;
+
+  // join() rethrows the exception of a thread started with propagate_exceptions:
+  {
+    std::jthread_group group;
+    group.emplace_back(std::propagate_exceptions, [] {
+                         throw std::runtime_error{"thread failed"};
+                       });
+    bool caught = false;
+    try {
+      group.join();
+    }
+    catch (const std::runtime_error&) {
+      caught = true;
+    }
+    assert(caught);
+  }
+
+  // join_until() handles all threads before it rethrows:
+  {
+    std::jthread_group group;
+    group.emplace_back([] (std::stop_token st) {
+                         while (!st.stop_requested()) {
+                           std::this_thread::sleep_for(1ms);
+                         }
+                       });
+    group.emplace_back(std::propagate_exceptions, [] {
+                         throw std::runtime_error{"thread failed"};
+                       });
+    group.emplace_back([] {});
+    bool caught = false;
+    try {
+      group.join_for(100ms);
+    }
+    catch (const std::runtime_error&) {
+      caught = true;
+    }
+    assert(caught);
+    assert(group[0].joinable());    // straggler
+    assert(!group[1].joinable());
+    assert(!group[2].joinable());   // joined after the exception
+  }
+
+  // the destructor discards it (instead of calling terminate()):
+  std::atomic<bool> otherJoined{false};
+  {
+    std::jthread_group group;
+    group.emplace_back(std::propagate_exceptions, [] {
+                         throw std::runtime_error{"thread failed"};
+                       });
+    group.emplace_back([&otherJoined] (std::stop_token st) {
+                         while (!st.stop_requested()) {
+                           std::this_thread::sleep_for(1ms);
+                         }
+                         otherJoined = true;
+                       });
+    std::this_thread::sleep_for(10ms);
+  }
+  assert(otherJoined);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testGroupStopAll();
+  std::cout << "\n\n**************************\n";
+  testGroupArgs();
+  std::cout << "\n\n**************************\n";
+  testGroupJoinUntil();
+  std::cout << "\n\n**************************\n";
+  testGroupExceptions();
+  std::cout << "\n\n**************************\n";
+}
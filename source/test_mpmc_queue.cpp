@@ -0,0 +1,161 @@
+#include "mpmc_queue.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testTryPushPop()
+{
+  std::cout << "*** start testTryPushPop()" << std::endl;
+
+  std::mpmc_queue<std::string> q{3};
+  assert(q.capacity() == 4);
+  assert(!q.try_pop());
+  for (int i = 0; i < 4; ++i) {
+    assert(q.try_push(std::to_string(i)));
+  }
+  std::string s{"x"};
+  assert(!q.try_push(std::move(s)));
+  assert(s == "x");   // not moved if full
+  assert(q.size_approx() == 4);
+
+  // FIFO, also when wrapping around:
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      auto v = q.try_pop();
+      assert(v && *v == std::to_string(round * 4 + i));
+      assert(q.try_push(std::to_string((round + 1) * 4 + i)));
+    }
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testDestroyRemaining()
+{
+  std::cout << "*** start testDestroyRemaining()" << std::endl;
+
+  auto p = std::make_shared<int>(42);
+  {
+    std::mpmc_queue<std::shared_ptr<int>> q{8};
+    q.try_push(p);
+    q.try_push(p);
+    assert(p.use_count() == 3);
+    q.try_pop();
+    assert(p.use_count() == 2);
+  }
+  assert(p.use_count() == 1);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testBlocking()
+{
+  std::cout << "*** start testBlocking()" << std::endl;
+
+  std::mpmc_queue<int> q{2};
+  {
+    // full queue: push blocks until there is space:
+    assert(q.push(1) && q.push(2));
+    std::jthread consumer{[&] {
+                            std::this_thread::sleep_for(50ms);
+                            assert(q.pop() == 1);
+                          }};
+    assert(q.push(3));
+  }
+  {
+    // stop wakes up blocked push immediately:
+    std::stop_source ssrc;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           ssrc.request_stop();
+                         }};
+    auto start = std::chrono::steady_clock::now();
+    assert(!q.push(4, ssrc.get_token()));
+    assert(std::chrono::steady_clock::now() - start < 1s);
+  }
+  assert(q.pop() == 2 && q.pop() == 3);
+  {
+    // stop wakes up blocked pop immediately:
+    std::stop_source ssrc;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           ssrc.request_stop();
+                         }};
+    assert(!q.pop(ssrc.get_token()));
+    // already stopped:
+    assert(!q.pop(ssrc.get_token()));
+    assert(q.push(5, ssrc.get_token()));   // doesn't have to block
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testMPMC()
+{
+  // each element is popped exactly once
+  std::cout << "*** start testMPMC()" << std::endl;
+
+  constexpr int numProducers = 4;
+  constexpr int numConsumers = 4;
+  constexpr int numPerProducer = 100000;
+  std::mpmc_queue<int> q{64};
+  std::vector<std::atomic<int>> seen(numProducers * numPerProducer);
+  std::atomic<int> consumed{0};
+  std::stop_source done;
+  {
+    std::vector<std::jthread> threads;
+    for (int c = 0; c < numConsumers; ++c) {
+      threads.emplace_back([&] {
+                             while (auto v = q.pop(done.get_token())) {
+                               seen[*v].fetch_add(1);
+                               if (consumed.fetch_add(1) + 1 == numProducers * numPerProducer) {
+                                 done.request_stop();
+                               }
+                             }
+                           });
+    }
+    for (int p = 0; p < numProducers; ++p) {
+      threads.emplace_back([&, p] {
+                             for (int i = 0; i < numPerProducer; ++i) {
+                               assert(q.push(p * numPerProducer + i));
+                             }
+                           });
+    }
+  }
+  assert(consumed.load() == numProducers * numPerProducer);
+  for (auto& s : seen) {
+    assert(s.load() == 1);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testTryPushPop();
+  std::cout << "\n\n**************************\n";
+  testDestroyRemaining();
+  std::cout << "\n\n**************************\n";
+  testBlocking();
+  std::cout << "\n\n**************************\n";
+  testMPMC();
+  std::cout << "\n\n**************************\n";
+}
@@ -0,0 +1,369 @@
+#include "parallel_algorithm.hpp"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testParallelFor()
+{
+  std::cout << "*** start testParallelFor()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<int> v(1000000, 1);
+  auto r = std::parallel_for(pool, v.begin(), v.end(), [] (int& i) { ++i; });
+  assert(!r.stopped && r.processed == v.size());
+  for (int i : v) {
+    assert(i == 2);
+  }
+
+  // explicit chunk sizes, including ones not dividing the size:
+  for (std::size_t chunk : {1u, 7u, 1000u, 2000000u}) {
+    std::vector<int> w(10007, 0);
+    r = std::parallel_for(pool, w.begin(), w.end(), [] (int& i) { ++i; }, {}, chunk);
+    assert(r.processed == w.size());
+    assert(std::count(w.begin(), w.end(), 1) == static_cast<long>(w.size()));
+  }
+
+  // empty range:
+  r = std::parallel_for(pool, v.begin(), v.begin(), [] (int&) { assert(false); });
+  assert(!r.stopped && r.processed == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testParallelForStop()
+{
+  // on cancel exactly the elements of a prefix were processed
+  std::cout << "*** start testParallelForStop()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<int> v(1000000, 0);
+  std::stop_source ssrc;
+  std::atomic<int> count{0};
+  auto r = std::parallel_for(pool, v.begin(), v.end(),
+                             [&] (int& i) {
+                               ++i;
+                               if (count.fetch_add(1) == 10000) {
+                                 ssrc.request_stop();
+                               }
+                             },
+                             ssrc.get_token(), 1000);
+  std::cout << "  processed " << r.processed << " of " << v.size() << std::endl;
+  assert(r.stopped);
+  assert(r.processed >= 10000 && r.processed < v.size());
+  assert(r.processed % 1000 == 0);
+  assert(static_cast<std::size_t>(count.load()) == r.processed);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    assert(v[i] == (i < r.processed ? 1 : 0));
+  }
+
+  // stop requested before the start:
+  std::stop_source stopped;
+  stopped.request_stop();
+  r = std::parallel_for(pool, v.begin(), v.end(), [] (int&) { assert(false); }, stopped.get_token());
+  assert(r.stopped && r.processed == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testTransformReduce()
+{
+  std::cout << "*** start testTransformReduce()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<long> v(1000000);
+  std::iota(v.begin(), v.end(), 0L);
+  const long expected = std::accumulate(v.begin(), v.end(), 42L,
+                                        [] (long sum, long i) { return sum + i % 7; });
+  auto r = std::parallel_transform_reduce(pool, v.begin(), v.end(), 42L,
+                                          std::plus<>{}, [] (long i) { return i % 7; });
+  assert(!r.stopped && r.processed == v.size());
+  assert(r.value == expected);
+
+  // chunk results are combined in order (string concatenation isn't commutative):
+  std::vector<char> chars(1000);
+  for (std::size_t i = 0; i < chars.size(); ++i) {
+    chars[i] = static_cast<char>('a' + i % 26);
+  }
+  auto s = std::parallel_transform_reduce(pool, chars.begin(), chars.end(), std::string{">"},
+                                          std::plus<>{}, [] (char c) { return std::string(1, c); },
+                                          {}, 10);
+  assert(s.value == ">" + std::string(chars.begin(), chars.end()));
+
+  // empty range:
+  auto e = std::parallel_transform_reduce(pool, v.begin(), v.begin(), 42L,
+                                          std::plus<>{}, [] (long i) { return i; });
+  assert(e.value == 42 && e.processed == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testTransformReduceStop()
+{
+  // the value is the reduction of the processed prefix
+  std::cout << "*** start testTransformReduceStop()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<long> v(1000000, 1);
+  std::stop_source ssrc;
+  std::atomic<int> count{0};
+  auto r = std::parallel_transform_reduce(pool, v.begin(), v.end(), 0L, std::plus<>{},
+                                          [&] (long i) {
+                                            if (count.fetch_add(1) == 5000) {
+                                              ssrc.request_stop();
+                                            }
+                                            return i;
+                                          },
+                                          ssrc.get_token(), 100);
+  std::cout << "  processed " << r.processed << " of " << v.size() << std::endl;
+  assert(r.stopped);
+  assert(r.processed > 5000 && r.processed < v.size());
+  assert(r.value == static_cast<long>(r.processed));
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testException()
+{
+  std::cout << "*** start testException()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<int> v(100000);
+  std::iota(v.begin(), v.end(), 0);
+  bool caught = false;
+  try {
+    std::parallel_for(pool, v.begin(), v.end(),
+                      [] (int i) {
+                        if (i == 5000) {
+                          throw std::runtime_error{"element 5000"};
+                        }
+                      });
+  }
+  catch (const std::runtime_error&) {
+    caught = true;
+  }
+  assert(caught);
+
+  // pool still usable:
+  auto r = std::parallel_for(pool, v.begin(), v.end(), [] (int& i) { i = 0; });
+  assert(r.processed == v.size());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testNested()
+{
+  // nested calls from workers make progress even if all workers are busy
+  std::cout << "*** start testNested()" << std::endl;
+
+  std::thread_pool pool{2};
+  std::vector<std::vector<int>> rows(8, std::vector<int>(10000, 1));
+  auto r = std::parallel_transform_reduce(pool, rows.begin(), rows.end(), 0L, std::plus<>{},
+                                          [&pool] (const std::vector<int>& row) {
+                                            return std::parallel_transform_reduce(pool, row.begin(), row.end(),
+                                                                                  0L, std::plus<>{},
+                                                                                  [] (int i) { return long{i}; }).value;
+                                          },
+                                          {}, 1);
+  assert(r.value == 80000);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testNestedInAllWorkers()
+{
+  // calls from all workers at the same time don't wait for each other's pool tasks
+  std::cout << "*** start testNestedInAllWorkers()" << std::endl;
+
+  std::thread_pool pool{2};
+  for (int round = 0; round < 20; ++round) {
+    std::atomic<int> started{0};
+    std::atomic<int> done{0};
+    for (int t = 0; t < 2; ++t) {
+      pool.submit([&] {
+                    // ensure that both workers are inside parallel_for():
+                    ++started;
+                    while (started.load() < 2) {
+                      std::this_thread::yield();
+                    }
+                    std::vector<int> v(10000, 1);
+                    auto r = std::parallel_for(pool, v.begin(), v.end(), [] (int& i) { ++i; });
+                    assert(r.processed == v.size());
+                    assert(std::count(v.begin(), v.end(), 2) == 10000);
+                    ++done;
+                  });
+    }
+    auto timeout = std::chrono::steady_clock::now() + 10s;
+    while (done.load() < 2) {
+      assert(std::chrono::steady_clock::now() < timeout);
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testStoppedPool()
+{
+  // the algorithms return on a stopped pool and if the pool is stopped during a call
+  // (the caller processes the remaining chunks itself)
+  std::cout << "*** start testStoppedPool()" << std::endl;
+
+  std::vector<int> v(100000, 1);
+  {
+    std::thread_pool pool{2};
+    pool.request_stop();
+    auto r1 = std::parallel_for(pool, v.begin(), v.end(), [] (int& i) { i = 2; });
+    assert(r1.processed == v.size() && !r1.stopped);
+    assert(std::count(v.begin(), v.end(), 2) == 100000);
+    auto r2 = std::parallel_transform_reduce(pool, v.begin(), v.end(), 0L, std::plus<>{},
+                                             [] (int i) { return long{i}; });
+    assert(r2.value == 200000 && !r2.stopped);
+    assert(std::parallel_find_if(pool, v.begin(), v.end(), [] (int i) { return i != 2; }) == v.end());
+  }
+  for (bool fromWorker : {false, true}) {
+    std::thread_pool pool{2};
+    std::atomic<std::size_t> numDone{0};
+    std::atomic<bool> returned{false};
+    auto call = [&] {
+                  auto r = std::parallel_for(pool, v.begin(), v.end(),
+                                             [&] (int&) {
+                                               if (numDone.fetch_add(1) % 1000 == 0) {
+                                                 std::this_thread::sleep_for(100us);
+                                               }
+                                             },
+                                             {}, 100);
+                  assert(r.processed == v.size());
+                  returned = true;
+                };
+    std::thread caller;
+    if (fromWorker) {
+      pool.submit(call);
+    }
+    else {
+      caller = std::thread{call};
+    }
+    while (numDone.load() < 1000) {
+      std::this_thread::sleep_for(1ms);
+    }
+    pool.request_stop();
+    auto timeout = std::chrono::steady_clock::now() + 10s;
+    while (!returned.load()) {
+      assert(std::chrono::steady_clock::now() < timeout);
+      std::this_thread::sleep_for(1ms);
+    }
+    if (caller.joinable()) {
+      caller.join();
+    }
+    assert(numDone.load() == v.size());
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testFindIf()
+{
+  std::cout << "*** start testFindIf()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<int> v(1000000, 0);
+  assert(std::parallel_find_if(pool, v.begin(), v.end(), [] (int i) { return i != 0; }) == v.end());
+
+  // leftmost of several matches in different chunks:
+  for (std::size_t pos : {0u, 1u, 4999u, 500000u, 999999u}) {
+    std::vector<int> w(v);
+    w[pos] = 1;
+    if (pos + 7 < w.size()) {
+      w[pos + 7] = 1;
+    }
+    w.back() = 1;
+    for (std::size_t chunk : {1u, 8u, 0u}) {
+      auto it = std::parallel_find_if(pool, w.begin(), w.end(), [] (int i) { return i != 0; }, {}, chunk);
+      assert(it == w.begin() + static_cast<long>(pos));
+    }
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testFindIfEarlyExit()
+{
+  // after the first match no further chunks are claimed
+  std::cout << "*** start testFindIfEarlyExit()" << std::endl;
+
+  std::thread_pool pool{4};
+  std::vector<int> v(1000000, 0);
+  v[1000] = 1;
+  std::atomic<std::size_t> calls{0};
+  auto it = std::parallel_find_if(pool, v.begin(), v.end(),
+                                  [&] (int i) {
+                                    calls.fetch_add(1, std::memory_order_relaxed);
+                                    return i != 0;
+                                  },
+                                  {}, 100);
+  assert(it == v.begin() + 1000);
+  std::cout << "  " << calls.load() << " predicate calls" << std::endl;
+  assert(calls.load() < 10000);
+
+  assert(std::parallel_any_of(pool, v.begin(), v.end(), [] (int i) { return i == 1; }));
+  assert(!std::parallel_any_of(pool, v.begin(), v.end(), [] (int i) { return i == 2; }));
+  assert(std::parallel_none_of(pool, v.begin(), v.end(), [] (int i) { return i == 2; }));
+  assert(std::parallel_all_of(pool, v.begin(), v.end(), [] (int i) { return i < 2; }));
+  assert(!std::parallel_all_of(pool, v.begin(), v.end(), [] (int i) { return i == 0; }));
+
+  // stopped before the start:
+  std::stop_source ssrc;
+  ssrc.request_stop();
+  assert(std::parallel_find_if(pool, v.begin(), v.end(), [] (int i) { return i != 0; },
+                               ssrc.get_token()) == v.end());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testParallelFor();
+  std::cout << "\n\n**************************\n";
+  testParallelForStop();
+  std::cout << "\n\n**************************\n";
+  testTransformReduce();
+  std::cout << "\n\n**************************\n";
+  testTransformReduceStop();
+  std::cout << "\n\n**************************\n";
+  testException();
+  std::cout << "\n\n**************************\n";
+  testNested();
+  std::cout << "\n\n**************************\n";
+  testNestedInAllWorkers();
+  std::cout << "\n\n**************************\n";
+  testStoppedPool();
+  std::cout << "\n\n**************************\n";
+  testFindIf();
+  std::cout << "\n\n**************************\n";
+  testFindIfEarlyExit();
+  std::cout << "\n\n**************************\n";
+}
@@ -0,0 +1,243 @@
+#include "pipeline.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testBoundedQueue()
+{
+  std::cout << "*** start testBoundedQueue()" << std::endl;
+
+  std::bounded_queue<int> q{4};
+  assert(q.push(1) && q.push(2));
+  std::vector<int> in{3, 4, 5, 6};
+  // only two elements fit without a consumer, so stop the push after a while:
+  std::stop_source ssrc;
+  std::jthread stopper{[&] {
+                         std::this_thread::sleep_for(50ms);
+                         ssrc.request_stop();
+                       }};
+  auto pos = q.push_batch(in.begin(), in.end(), ssrc.get_token());
+  assert(pos == in.begin() + 2);
+  assert(q.size() == 4);
+
+  std::vector<int> out;
+  assert(q.pop_batch(out, 3) == 3);
+  assert((out == std::vector<int>{1, 2, 3}));
+  assert(q.pop() == 4);
+
+  // pop on an empty queue returns on stop:
+  std::stop_source ssrc2;
+  std::jthread stopper2{[&] {
+                          std::this_thread::sleep_for(50ms);
+                          ssrc2.request_stop();
+                        }};
+  assert(!q.pop(ssrc2.get_token()));
+
+  // close() fails pushes but remaining elements are drained:
+  assert(q.push(7));
+  q.close();
+  assert(!q.push(8));
+  assert(q.pop() == 7);
+  assert(!q.pop());
+  assert(q.pop_batch(out, 10) == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testBackPressure()
+{
+  // a blocked producer is woken by a consumer
+  std::cout << "*** start testBackPressure()" << std::endl;
+
+  std::bounded_queue<int> q{8};
+  std::jthread producer{[&] {
+                          std::vector<int> v(1000);
+                          std::iota(v.begin(), v.end(), 0);
+                          for (auto it = v.begin(); it != v.end(); it += 100) {
+                            assert(q.push_batch(it, it + 100) == it + 100);
+                            assert(q.size() <= q.capacity());
+                          }
+                          q.close();
+                        }};
+  std::vector<int> out;
+  while (q.pop_batch(out, 3) > 0) {
+  }
+  assert(out.size() == 1000);
+  for (int i = 0; i < 1000; ++i) {
+    assert(out[i] == i);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPipeline()
+{
+  std::cout << "*** start testPipeline()" << std::endl;
+
+  long sum = 0;
+  {
+    std::pipeline p{16, 4};
+    auto nums = p.add_source([i = 0] (std::stop_token) mutable -> std::optional<int> {
+                               if (i == 10000) {
+                                 return std::nullopt;
+                               }
+                               return ++i;
+                             });
+    auto squares = p.add_stage(nums, [] (int i) { return long{i} * i; }, 3);
+    auto strs = p.add_stage(squares, [] (long i) { return std::to_string(i); });
+    p.add_sink(strs, [&sum] (const std::string& s) { sum += std::stol(s); });
+    p.wait();
+  }
+  assert(sum == 10000L * 10001 * 20001 / 6);
+
+  // order is preserved with single threaded stages:
+  std::vector<int> out;
+  {
+    std::pipeline p{8, 3};
+    auto nums = p.add_source([i = 0] (std::stop_token) mutable -> std::optional<int> {
+                               return i < 100 ? std::optional<int>{i++} : std::nullopt;
+                             });
+    p.add_sink(p.add_stage(nums, [] (int i) { return i + 1; }),
+               [&out] (int i) { out.push_back(i); });
+    p.wait();
+  }
+  assert(out.size() == 100);
+  for (int i = 0; i < 100; ++i) {
+    assert(out[i] == i + 1);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testDrain()
+{
+  // everything produced before the stop is processed by all stages
+  std::cout << "*** start testDrain()" << std::endl;
+
+  std::atomic<long> produced{0};
+  std::atomic<long> consumed{0};
+  std::pipeline p{32, 8};
+  auto nums = p.add_source([&] (std::stop_token) -> std::optional<int> {
+                             produced.fetch_add(1);
+                             return 1;
+                           });
+  auto s1 = p.add_stage(nums, [] (int i) { return i; }, 2);
+  auto s2 = p.add_stage(s1, [] (int i) {
+                              std::this_thread::sleep_for(10us);
+                              return i;
+                            });
+  p.add_sink(s2, [&] (int i) { consumed.fetch_add(i); });
+  std::this_thread::sleep_for(100ms);
+  p.request_stop(std::pipeline::stop_mode::drain);
+  p.wait();
+  std::cout << "  produced/consumed " << produced.load() << "/" << consumed.load() << std::endl;
+  assert(produced.load() > 0);
+  assert(produced.load() == consumed.load());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testAbort()
+{
+  // abort returns quickly even if queues are full and the source blocks
+  std::cout << "*** start testAbort()" << std::endl;
+
+  std::atomic<long> consumed{0};
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::pipeline p{16, 4};
+    auto nums = p.add_source([] (std::stop_token stoken) -> std::optional<int> {
+                               // interruptible wait for the next element:
+                               std::mutex mx;
+                               std::condition_variable_any2 cv;
+                               std::unique_lock lock{mx};
+                               cv.wait_for(lock, stoken, 1ms, [] { return false; });
+                               return 1;
+                             });
+    p.add_sink(p.add_stage(nums, [] (int i) { return i; }),
+               [&] (int i) {
+                 std::this_thread::sleep_for(100ms);
+                 consumed.fetch_add(i);
+               });
+    std::this_thread::sleep_for(200ms);
+    p.request_stop(std::pipeline::stop_mode::abort);
+    p.wait();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "  consumed " << consumed.load() << std::endl;
+  assert(elapsed < 1s);
+  assert(consumed.load() < 10);
+
+  // the destructor aborts:
+  start = std::chrono::steady_clock::now();
+  {
+    std::pipeline p{4, 1};
+    auto nums = p.add_source([] (std::stop_token) -> std::optional<int> { return 1; });
+    p.add_sink(nums, [] (int) { std::this_thread::sleep_for(1ms); });
+  }
+  assert(std::chrono::steady_clock::now() - start < 1s);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testException()
+{
+  std::cout << "*** start testException()" << std::endl;
+
+  std::pipeline p{16, 4};
+  auto nums = p.add_source([i = 0] (std::stop_token) mutable -> std::optional<int> { return ++i; });
+  auto checked = p.add_stage(nums, [] (int i) {
+                                     if (i == 1000) {
+                                       throw std::runtime_error{"element 1000"};
+                                     }
+                                     return i;
+                                   });
+  p.add_sink(checked, [] (int) {});
+  bool caught = false;
+  try {
+    p.wait();
+  }
+  catch (const std::runtime_error& e) {
+    caught = true;
+    assert(std::string{e.what()} == "element 1000");
+  }
+  assert(caught);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testBoundedQueue();
+  std::cout << "\n\n**************************\n";
+  testBackPressure();
+  std::cout << "\n\n**************************\n";
+  testPipeline();
+  std::cout << "\n\n**************************\n";
+  testDrain();
+  std::cout << "\n\n**************************\n";
+  testAbort();
+  std::cout << "\n\n**************************\n";
+  testException();
+  std::cout << "\n\n**************************\n";
+}
@@ -0,0 +1,202 @@
+#include "spsc_queue.hpp"
+#include "jthread.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testTryPushPop()
+{
+  std::cout << "*** start testTryPushPop()" << std::endl;
+
+  std::spsc_queue<std::string> q{3};
+  assert(q.capacity() == 4);
+  assert(!q.try_pop());
+  for (int i = 0; i < 4; ++i) {
+    assert(q.try_push(std::to_string(i)));
+  }
+  std::string s{"x"};
+  assert(!q.try_push(std::move(s)));
+  assert(s == "x");   // not moved if full
+  assert(q.size_approx() == 4);
+
+  // FIFO, also when wrapping around:
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      auto v = q.try_pop();
+      assert(v && *v == std::to_string(round * 4 + i));
+      assert(q.try_push(std::to_string((round + 1) * 4 + i)));
+    }
+  }
+
+  // destructor destroys the remaining elements:
+  auto p = std::make_shared<int>(42);
+  {
+    std::spsc_queue<std::shared_ptr<int>> q2{8};
+    q2.try_push(p);
+    q2.try_push(p);
+    q2.try_pop();
+    assert(p.use_count() == 2);
+  }
+  assert(p.use_count() == 1);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testBatch()
+{
+  std::cout << "*** start testBatch()" << std::endl;
+
+  std::spsc_queue<int> q{8};
+  std::vector<int> in{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  auto pos = q.try_push_batch(in.begin(), in.end());
+  assert(pos == in.begin() + 8);
+  std::vector<int> out;
+  assert(q.try_pop_batch(std::back_inserter(out), 3) == 3);
+  assert((out == std::vector<int>{1, 2, 3}));
+  assert(q.try_push_batch(pos, in.end()) == in.end());
+  assert(q.try_pop_batch(std::back_inserter(out), 100) == 7);
+  assert(out == in);
+  assert(q.try_pop_batch(std::back_inserter(out), 100) == 0);
+
+  // elements pushed before an iterator throws are published:
+  struct ThrowingIt {
+    int i;
+    int operator*() const {
+      if (i == 3) {
+        throw std::runtime_error{"bad element"};
+      }
+      return i;
+    }
+    ThrowingIt& operator++() {
+      ++i;
+      return *this;
+    }
+    bool operator!=(const ThrowingIt& other) const {
+      return i != other.i;
+    }
+  };
+  try {
+    q.try_push_batch(ThrowingIt{0}, ThrowingIt{6});
+    assert(false);
+  }
+  catch (const std::runtime_error&) {
+  }
+  assert(q.size_approx() == 3);
+  out.clear();
+  assert(q.try_pop_batch(std::back_inserter(out), 100) == 3);
+  assert((out == std::vector<int>{0, 1, 2}));
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testBlocking()
+{
+  std::cout << "*** start testBlocking()" << std::endl;
+
+  std::spsc_queue<int> q{2};
+  {
+    // full queue: push blocks until there is space:
+    assert(q.push(1) && q.push(2));
+    std::jthread consumer{[&] {
+                            std::this_thread::sleep_for(50ms);
+                            assert(q.pop() == 1);
+                          }};
+    assert(q.push(3));
+  }
+  {
+    // stop wakes up blocked push immediately:
+    std::stop_source ssrc;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           ssrc.request_stop();
+                         }};
+    auto start = std::chrono::steady_clock::now();
+    assert(!q.push(4, ssrc.get_token()));
+    assert(std::chrono::steady_clock::now() - start < 1s);
+  }
+  assert(q.pop() == 2 && q.pop() == 3);
+  {
+    // stop wakes up blocked pop immediately:
+    std::stop_source ssrc;
+    std::jthread stopper{[&] {
+                           std::this_thread::sleep_for(50ms);
+                           ssrc.request_stop();
+                         }};
+    assert(!q.pop(ssrc.get_token()));
+    assert(!q.pop(ssrc.get_token()));
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testTransfer()
+{
+  // all elements arrive in order, mixing single and batch operations
+  std::cout << "*** start testTransfer()" << std::endl;
+
+  constexpr int num = 1000000;
+  std::spsc_queue<int> q{64};
+  std::jthread producer{[&] {
+                          std::vector<int> batch;
+                          for (int i = 0; i < num; ) {
+                            if (i % 3 == 0) {
+                              assert(q.push(i++));
+                            }
+                            else {
+                              batch.clear();
+                              for (int j = 0; j < 10 && i < num; ++j) {
+                                batch.push_back(i++);
+                              }
+                              // block for the rest if the queue is full:
+                              auto it = q.try_push_batch(batch.begin(), batch.end());
+                              for (; it != batch.end(); ++it) {
+                                assert(q.push(*it));
+                              }
+                            }
+                          }
+                        }};
+  std::vector<int> out;
+  out.reserve(num);
+  while (static_cast<int>(out.size()) < num) {
+    if (out.size() % 2 != 0 && q.try_pop_batch(std::back_inserter(out), 7) > 0) {
+      continue;
+    }
+    out.push_back(*q.pop());
+  }
+  for (int i = 0; i < num; ++i) {
+    assert(out[i] == i);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testTryPushPop();
+  std::cout << "\n\n**************************\n";
+  testBatch();
+  std::cout << "\n\n**************************\n";
+  testBlocking();
+  std::cout << "\n\n**************************\n";
+  testTransfer();
+  std::cout << "\n\n**************************\n";
+}
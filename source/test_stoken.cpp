@@ -287,6 +287,51 @@ void testStopTokenAPI()
 }
 
 
+//------------------------------------------------------
+
+void testTokensOutliveSource()
+{
+  std::cout << "\n============= testTokensOutliveSource()\n";
+
+  // the stop state has to live until the LAST token is gone
+  // (it was deleted with the first token destroyed after the last source,
+  //  which reliably fails with -fsanitize=address):
+  std::stop_token remaining;
+  {
+    std::stop_source ssrc;
+    std::stop_token tok1{ssrc.get_token()};
+    remaining = ssrc.get_token();
+    ssrc.request_stop();
+  } // destroys the source, then tok1
+  assert(remaining.stop_requested());
+  assert(remaining.stop_possible());
+  {
+    std::stop_source other;
+    assert(!other.stop_requested());
+    std::stop_token copy{remaining};
+    assert(copy == remaining);
+    assert(copy.stop_requested());
+  }
+  assert(remaining.stop_requested());
+
+  // same without stop requested (then the state is no longer stop_possible()):
+  {
+    std::stop_token last;
+    {
+      std::stop_source ssrc;
+      std::stop_token tok1{ssrc.get_token()};
+      last = tok1;
+    }
+    std::stop_source other;
+    other.request_stop();
+    assert(!last.stop_requested());
+    assert(!last.stop_possible());
+  }
+
+  std::cout << "**** all OK\n";
+}
+
+
 //------------------------------------------------------
 
 template<typename D>
@@ -360,6 +405,7 @@ int main()
 {
   testStopTokenBasicAPI();
   testStopTokenAPI();
+  testTokensOutliveSource();
   testSToken(::std::chrono::seconds{0});
   testSToken(::std::chrono::milliseconds{500});
 }
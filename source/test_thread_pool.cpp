@@ -0,0 +1,277 @@
+#include "thread_pool.hpp"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+using namespace::std::literals;
+
+//------------------------------------------------------
+
+void testWsDequeSingleThreaded()
+{
+  std::cout << "*** start testWsDequeSingleThreaded()" << std::endl;
+
+  int values[1000];
+  std::__ws_deque<int*> dq{4};   // small capacity to force growing
+  assert(dq.empty());
+  assert(dq.take() == nullptr);
+  assert(dq.steal() == nullptr);
+
+  for (int i = 0; i < 1000; ++i) {
+    dq.push(&values[i]);
+  }
+  assert(!dq.empty());
+  // owner takes LIFO, thieves steal FIFO:
+  assert(dq.take() == &values[999]);
+  assert(dq.steal() == &values[0]);
+  assert(dq.take() == &values[998]);
+  assert(dq.steal() == &values[1]);
+  int n = 0;
+  while (dq.take() != nullptr) {
+    ++n;
+  }
+  assert(n == 996);
+  assert(dq.empty());
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testWsDequeConcurrent()
+{
+  std::cout << "*** start testWsDequeConcurrent()" << std::endl;
+
+  constexpr int numItems = 100000;
+  std::vector<int> items(numItems);
+  std::vector<std::atomic<int>> seen(numItems);
+  std::__ws_deque<int*> dq{2};
+  std::atomic<bool> done{false};
+
+  auto consume = [&] (int* p) {
+                   seen[p - items.data()].fetch_add(1);
+                 };
+  {
+    std::vector<std::jthread> thieves;
+    for (int i = 0; i < 3; ++i) {
+      thieves.emplace_back([&] {
+                             while (!done.load() || !dq.empty()) {
+                               if (int* p = dq.steal()) {
+                                 consume(p);
+                               }
+                             }
+                           });
+    }
+    // owner pushes and takes in turns:
+    for (int i = 0; i < numItems; ++i) {
+      dq.push(&items[i]);
+      if (i % 3 == 0) {
+        if (int* p = dq.take()) {
+          consume(p);
+        }
+      }
+    }
+    while (int* p = dq.take()) {
+      consume(p);
+    }
+    done.store(true);
+  }
+  // each item was processed exactly once:
+  for (auto& s : seen) {
+    assert(s.load() == 1);
+  }
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPoolSubmit()
+{
+  std::cout << "*** start testPoolSubmit()" << std::endl;
+
+  constexpr int numTasks = 10000;
+  std::atomic<int> count{0};
+  {
+    std::thread_pool pool{4};
+    assert(pool.size() == 4);
+    for (int i = 0; i < numTasks; ++i) {
+      pool.submit([&count] { count.fetch_add(1); });
+    }
+    while (count.load() < numTasks) {
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+  assert(count.load() == numTasks);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPoolNestedSubmit()
+{
+  // tasks submitted by workers go to their local deques and get stolen by others
+  std::cout << "*** start testPoolNestedSubmit()" << std::endl;
+
+  std::atomic<int> leafs{0};
+  std::mutex idsMx;
+  std::set<std::thread::id> ids;
+  {
+    std::thread_pool pool{4};
+    // binary tree of tasks with 2^12 leafs:
+    std::function<void(int)> spawn = [&] (int depth) {
+        {
+          std::lock_guard<std::mutex> lg{idsMx};
+          ids.insert(std::this_thread::get_id());
+        }
+        if (depth == 0) {
+          leafs.fetch_add(1);
+          return;
+        }
+        pool.submit([&spawn, depth] { spawn(depth-1); });
+        pool.submit([&spawn, depth] { spawn(depth-1); });
+      };
+    pool.submit([&spawn] { spawn(12); });
+    while (leafs.load() < (1 << 12)) {
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+  assert(leafs.load() == (1 << 12));
+  assert(!ids.empty() && ids.size() <= 4);
+  std::cout << "\n*** OK (" << ids.size() << " workers involved)" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPoolStopWakesSleepingWorkers()
+{
+  std::cout << "*** start testPoolStopWakesSleepingWorkers()" << std::endl;
+
+  auto pool = std::make_unique<std::thread_pool>(8);
+  std::atomic<int> count{0};
+  pool->submit([&count] { count.fetch_add(1); });
+  while (count.load() < 1) {
+    std::this_thread::sleep_for(1ms);
+  }
+  std::this_thread::sleep_for(100ms);   // let all workers park
+  auto start = std::chrono::steady_clock::now();
+  pool.reset();                         // signals stop and joins all workers
+  auto shutdown = std::chrono::steady_clock::now() - start;
+  std::cout << "  shutdown took "
+            << std::chrono::duration_cast<std::chrono::microseconds>(shutdown).count() << "us" << std::endl;
+  assert(shutdown < 1s);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPoolStopToken()
+{
+  // tasks taking a stop_token see the stop of the pool and pending tasks are dropped
+  std::cout << "*** start testPoolStopToken()" << std::endl;
+
+  std::atomic<int> running{0};
+  std::atomic<int> stopped{0};
+  std::atomic<int> started{0};
+  {
+    std::thread_pool pool{2};
+    for (int i = 0; i < 2; ++i) {
+      pool.submit([&] (std::stop_token st) {
+                    started.fetch_add(1);
+                    running.fetch_add(1);
+                    while (!st.stop_requested()) {
+                      std::this_thread::sleep_for(1ms);
+                    }
+                    stopped.fetch_add(1);
+                  });
+    }
+    while (running.load() < 2) {
+      std::this_thread::sleep_for(1ms);
+    }
+    // both workers are busy, so these are never started:
+    for (int i = 0; i < 10; ++i) {
+      pool.submit([&started] { started.fetch_add(1); });
+    }
+  } // destructor signals stop
+  assert(stopped.load() == 2);
+  assert(started.load() == 2);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+void testPoolStopDiscardsTasks()
+{
+  // on stop, state captured by tasks never started is destroyed while the pool still exists
+  std::cout << "*** start testPoolStopDiscardsTasks()" << std::endl;
+
+  std::thread_pool pool{2};
+  std::atomic<bool> release{false};
+  std::atomic<int> running{0};
+  std::atomic<int> started{0};
+  auto fromWorker = std::make_shared<int>(1);
+  auto fromOutside = std::make_shared<int>(2);
+  std::weak_ptr<int> fromWorkerRef = fromWorker;
+  std::weak_ptr<int> fromOutsideRef = fromOutside;
+  for (int i = 0; i < 2; ++i) {
+    // workers busy until released (ignoring the stop):
+    pool.submit([&, i, captured = (i == 0 ? std::move(fromWorker) : nullptr)] () mutable {
+                  if (captured) {
+                    // queued in the deque of this worker:
+                    pool.submit([&started, captured = std::move(captured)] { started.fetch_add(1); });
+                  }
+                  running.fetch_add(1);
+                  while (!release.load()) {
+                    std::this_thread::sleep_for(1ms);
+                  }
+                });
+  }
+  while (running.load() < 2) {
+    std::this_thread::sleep_for(1ms);
+  }
+  pool.submit([&started, captured = std::move(fromOutside)] { started.fetch_add(1); });
+  assert(!fromWorkerRef.expired());
+  assert(!fromOutsideRef.expired());
+
+  pool.request_stop();
+  assert(fromWorkerRef.expired());
+  assert(fromOutsideRef.expired());
+
+  // submitted after stop:
+  auto late = std::make_shared<int>(3);
+  std::weak_ptr<int> lateRef = late;
+  pool.submit([&started, captured = std::move(late)] { started.fetch_add(1); });
+  assert(lateRef.expired());
+
+  release = true;
+  assert(started.load() == 0);
+  std::cout << "\n*** OK" << std::endl;
+}
+
+//------------------------------------------------------
+
+int main()
+{
+  std::set_terminate([](){
+                       std::cout << "ERROR: terminate() called" << std::endl;
+                       assert(false);
+                     });
+
+  std::cout << "\n\n**************************\n";
+  testWsDequeSingleThreaded();
+  std::cout << "\n\n**************************\n";
+  testWsDequeConcurrent();
+  std::cout << "\n\n**************************\n";
+  testPoolSubmit();
+  std::cout << "\n\n**************************\n";
+  testPoolNestedSubmit();
+  std::cout << "\n\n**************************\n";
+  testPoolStopWakesSleepingWorkers();
+  std::cout << "\n\n**************************\n";
+  testPoolStopToken();
+  std::cout << "\n\n**************************\n";
+  testPoolStopDiscardsTasks();
+  std::cout << "\n\n**************************\n";
+}
@@ -0,0 +1,422 @@
+// -----------------------------------------------------
+// work-stealing thread pool running on jthreads:
+// -----------------------------------------------------
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "jthread.hpp"
+#include "condition_variable_any2.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace std {
+
+//*****************************************
+//* class __ws_deque
+//* - Chase-Lev work-stealing deque for pointers
+//*   (see Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient
+//*    Work-Stealing for Weak Memory Models", PPoPP'13)
+//* - push() and take() may only be called by the owning thread,
+//*   steal() may be called by any thread
+//*****************************************
+template <typename T>
+class __ws_deque
+{
+    static_assert(std::is_pointer_v<T>, "__ws_deque stores pointers only");
+
+    struct ring {
+        explicit ring(std::int64_t cap)
+         : capacity{cap}, slots{new std::atomic<T>[static_cast<std::size_t>(cap)]} {
+        }
+        T get(std::int64_t i) const noexcept {
+            return slots[static_cast<std::size_t>(i & (capacity - 1))].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, T x) noexcept {
+            slots[static_cast<std::size_t>(i & (capacity - 1))].store(x, std::memory_order_relaxed);
+        }
+        std::int64_t capacity;                  // always a power of 2
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+  public:
+    explicit __ws_deque(std::int64_t capacity = 256) {
+        _rings.push_back(std::make_unique<ring>(capacity));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
+    }
+    __ws_deque(const __ws_deque&) = delete;
+    __ws_deque& operator=(const __ws_deque&) = delete;
+
+    // owner only:
+    void push(T x) {
+        std::int64_t b = _bottom.load(std::memory_order_relaxed);
+        std::int64_t t = _top.load(std::memory_order_acquire);
+        ring* r = _ring.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only:
+    // - returns the most recently pushed element or nullptr if empty
+    T take() noexcept {
+        std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring* r = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = _top.load(std::memory_order_relaxed);
+        if (t > b) {
+            // empty:
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T x = r->get(b);
+        if (t == b) {
+            // last element: race against thieves
+            if (!_top.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                x = nullptr;
+            }
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // any thread:
+    // - returns the least recently pushed element or nullptr if empty
+    //   or if the steal lost a race (the caller might simply retry later)
+    T steal() noexcept {
+        std::int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        ring* r = _ring.load(std::memory_order_acquire);
+        T x = r->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return x;
+    }
+
+    bool empty() const noexcept {
+        return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+    }
+
+  private:
+    ring* grow(ring* old, std::int64_t t, std::int64_t b) {
+        auto bigger = std::make_unique<ring>(old->capacity * 2);
+        for (std::int64_t i = t; i != b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        // thieves might still read from the old ring, so it is kept until destruction:
+        _rings.push_back(std::move(bigger));
+        ring* r = _rings.back().get();
+        _ring.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(64) std::atomic<std::int64_t> _top{0};
+    alignas(64) std::atomic<std::int64_t> _bottom{0};
+    std::atomic<ring*> _ring{nullptr};
+    std::vector<std::unique_ptr<ring>> _rings;   // owner only
+};
+
+
+//*****************************************
+//* class thread_pool
+//* - fixed number of jthread workers, each owning a work-stealing deque
+//* - tasks submitted by a worker go to its own deque (LIFO for the owner),
+//*   tasks submitted from other threads go to a shared injection queue
+//* - idle workers steal from randomly chosen victims and finally park
+//*   in a stop-aware wait, so that request_stop() wakes them immediately
+//* - callables may take a stop_token, which is the stop_token of the
+//*   executing worker
+//* - on stop, tasks not started yet are destroyed without running them
+//*   (so that state they captured is released while the pool still exists)
+//*****************************************
+class thread_pool
+{
+    struct task {
+        virtual ~task() = default;
+        virtual void run(const stop_token& st) = 0;
+    };
+
+    template <typename Callable>
+    struct task_impl final : task {
+        template <typename CB>
+        explicit task_impl(CB&& cb) : _cb{::std::forward<CB>(cb)} {
+        }
+        void run(const stop_token& st) override {
+            if constexpr(std::is_invocable_v<Callable&, stop_token>) {
+                ::std::invoke(_cb, st);
+            }
+            else {
+                ::std::invoke(_cb);
+            }
+        }
+        Callable _cb;
+    };
+
+    struct worker {
+        __ws_deque<task*> tasks;
+        jthread thread;
+    };
+
+  public:
+    explicit thread_pool(unsigned numThreads = jthread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // submit a task:
+    // - tasks not started when the pool is stopped are discarded
+    //   (destroyed by request_stop() or, if queued by a running task, by its worker when it exits)
+    // - tasks submitted after stop are destroyed immediately
+    template <typename Callable>
+    void submit(Callable&& cb);
+
+    // signal stop to all workers (wakes up all sleeping workers)
+    // and discard all queued tasks:
+    void request_stop() noexcept;
+
+    // run one queued task in the calling thread, if it is a worker of this pool:
+    // - for workers waiting for tasks they submitted themselves
+    //   (e.g. nested parallel algorithms), which otherwise might wait for each other
+    // - own tasks are taken first, then tasks from outside, then stolen ones
+    // - returns false if the calling thread is no worker of this pool or no task was found
+    bool try_run_task();
+
+    unsigned size() const noexcept {
+        return static_cast<unsigned>(_workers.size());
+    }
+
+  private:
+    void run_worker(unsigned idx, stop_token st);
+    task* find_task(unsigned idx, std::uint32_t& rnd);
+    void enqueue(task* t);
+    void discard_queued() noexcept;
+    void discard(task* t) noexcept;
+
+    // calling thread is a worker of which pool (if any):
+    inline static thread_local thread_pool* _currentPool = nullptr;
+    inline static thread_local unsigned _currentIdx = 0;
+    inline static thread_local const stop_token* _currentToken = nullptr;
+
+    std::vector<std::unique_ptr<worker>> _workers;
+    std::mutex _injectMx;                      // guards _injected
+    std::deque<task*> _injected;               // tasks submitted from non-workers
+    alignas(64) std::atomic<std::size_t> _queued{0};   // submitted but not taken yet
+    alignas(64) std::atomic<unsigned> _sleepers{0};    // number of parked workers
+    std::atomic<bool> _stopped{false};
+    std::mutex _parkMx;
+    condition_variable_any2 _parkCV;
+};
+
+
+//**********************************************************************
+
+//*****************************************
+//* implementation of class thread_pool
+//*****************************************
+
+inline thread_pool::thread_pool(unsigned numThreads)
+{
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    // create all deques before any worker might try to steal from them:
+    _workers.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i) {
+        _workers.push_back(std::make_unique<worker>());
+    }
+    for (unsigned i = 0; i < numThreads; ++i) {
+        _workers[i]->thread = jthread{[this, i] (stop_token st) {
+                                        run_worker(i, std::move(st));
+                                      }};
+    }
+}
+
+inline thread_pool::~thread_pool()
+{
+    request_stop();
+    for (auto& w : _workers) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+    // (all tasks never started were discarded by request_stop() or by the exiting workers)
+}
+
+inline void thread_pool::request_stop() noexcept
+{
+    _stopped.store(true, std::memory_order_seq_cst);
+    // request stop for all workers before any of them has to react:
+    for (auto& w : _workers) {
+        w->thread.request_stop();
+    }
+    discard_queued();
+}
+
+// destroy all queued tasks (after stop):
+// - the deques of running workers are stolen from (their owners drain them when they exit)
+// - tasks are destroyed without holding _injectMx, as their destructors might submit
+inline void thread_pool::discard_queued() noexcept
+{
+    for (auto& w : _workers) {
+        while (!w->tasks.empty()) {
+            if (task* t = w->tasks.steal()) {
+                discard(t);
+            }
+        }
+    }
+    std::deque<task*> injected;
+    {
+        std::lock_guard<std::mutex> lg{_injectMx};
+        injected.swap(_injected);
+    }
+    for (task* t : injected) {
+        discard(t);
+    }
+}
+
+inline void thread_pool::discard(task* t) noexcept
+{
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    delete t;
+}
+
+template <typename Callable>
+inline void thread_pool::submit(Callable&& cb)
+{
+    enqueue(new task_impl<std::decay_t<Callable>>{::std::forward<Callable>(cb)});
+}
+
+inline void thread_pool::enqueue(task* t)
+{
+    if (_stopped.load(std::memory_order_relaxed)) {
+        delete t;
+        return;
+    }
+    // count before publishing, so that a worker never parks while a task is visible:
+    _queued.fetch_add(1, std::memory_order_seq_cst);
+    if (_currentPool == this) {
+        // (drained by the worker itself when it exits):
+        _workers[_currentIdx]->tasks.push(t);
+    }
+    else {
+        {
+            std::lock_guard<std::mutex> lg{_injectMx};
+            _injected.push_back(t);
+        }
+        // a concurrent request_stop() might have drained _injected before the push:
+        if (_stopped.load(std::memory_order_seq_cst)) {
+            discard_queued();
+            return;
+        }
+    }
+    if (_sleepers.load(std::memory_order_seq_cst) != 0) {
+        // a worker counted as sleeper checks _queued and registers as waiter under _parkMx,
+        // so pass the lock once to not notify within that window (lost wakeup):
+        {
+            std::lock_guard<std::mutex> lg{_parkMx};
+        }
+        _parkCV.notify_one();
+    }
+}
+
+inline bool thread_pool::try_run_task()
+{
+    if (_currentPool != this) {
+        return false;
+    }
+    std::uint32_t rnd = 2463534242u + _currentIdx * 2654435761u;
+    task* t = find_task(_currentIdx, rnd);
+    if (t == nullptr) {
+        return false;
+    }
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    t->run(*_currentToken);
+    delete t;
+    return true;
+}
+
+inline thread_pool::task* thread_pool::find_task(unsigned idx, std::uint32_t& rnd)
+{
+    // 1. own deque:
+    if (task* t = _workers[idx]->tasks.take()) {
+        return t;
+    }
+    // 2. tasks from outside:
+    {
+        std::lock_guard<std::mutex> lg{_injectMx};
+        if (!_injected.empty()) {
+            task* t = _injected.front();
+            _injected.pop_front();
+            return t;
+        }
+    }
+    // 3. steal, starting with a random victim (xorshift32):
+    const auto n = static_cast<unsigned>(_workers.size());
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    const unsigned start = rnd % n;
+    for (unsigned i = 0; i < n; ++i) {
+        const unsigned victim = (start + i) % n;
+        if (victim != idx) {
+            if (task* t = _workers[victim]->tasks.steal()) {
+                return t;
+            }
+        }
+    }
+    return nullptr;
+}
+
+inline void thread_pool::run_worker(unsigned idx, stop_token st)
+{
+    _currentPool = this;
+    _currentIdx = idx;
+    _currentToken = &st;
+    std::uint32_t rnd = 2463534242u + idx * 2654435761u;
+    while (!st.stop_requested()) {
+        if (task* t = find_task(idx, rnd)) {
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            t->run(st);
+            delete t;
+            continue;
+        }
+        // nothing found: park until new tasks are queued or stop is requested
+        // - a task counted in _queued might not be visible yet or a steal might have lost a race;
+        //   then the predicate is true and we simply search again
+        std::unique_lock<std::mutex> lock{_parkMx};
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        _parkCV.wait(lock, st, [this] {
+                                 return _queued.load(std::memory_order_seq_cst) != 0;
+                               });
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // tasks this worker queued after request_stop() drained its deque:
+    while (task* t = _workers[idx]->tasks.take()) {
+        discard(t);
+    }
+    _currentPool = nullptr;
+    _currentToken = nullptr;
+}
+
+
+} // std
+
+#endif // THREAD_POOL_HPP